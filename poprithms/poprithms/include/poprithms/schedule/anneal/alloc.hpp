@@ -2,6 +2,8 @@
 #ifndef POPRITHMS_SCHEDULE_ANNEAL_ALLOC_HPP
 #define POPRITHMS_SCHEDULE_ANNEAL_ALLOC_HPP
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include <poprithms/schedule/anneal/allocweight.hpp>
@@ -15,18 +17,31 @@ namespace anneal {
 class Alloc {
 
 public:
-  Alloc(AllocAddress a, AllocWeight w) : address(a), weight(w) {}
+  Alloc(AllocAddress a, AllocWeight w, ResourceClass r = 0)
+      : address(a), weight(w), resource(r) {}
+
+  // An Alloc with all of its Ops, which should be sorted and unique
+  Alloc(AllocAddress a,
+        AllocWeight w,
+        std::vector<OpAddress> ops_,
+        ResourceClass r = 0)
+      : address(a), weight(w), resource(r), ops(std::move(ops_)) {}
   AllocAddress getAddress() const { return address; }
   AllocWeight getWeight() const { return weight; }
+  ResourceClass getResourceClass() const { return resource; }
 
   // The Ops which require this Alloc to be live when they are scheduled
   void insertOp(OpAddress opAddress) { ops.push_back(opAddress); }
+  void removeOp(OpAddress opAddress) {
+    ops.erase(std::remove(ops.begin(), ops.end(), opAddress), ops.end());
+  }
   const std::vector<OpAddress> &getOps() const { return ops; }
   size_t nOps() const { return getOps().size(); }
   int nOps_i32() const { return static_cast<int>(nOps()); }
 
   bool operator==(const Alloc &rhs) const {
-    return address == rhs.address && weight == rhs.weight && ops == rhs.ops;
+    return address == rhs.address && weight == rhs.weight &&
+           resource == rhs.resource && ops == rhs.ops;
   }
 
   void append(std::ostream &) const;
@@ -40,6 +55,11 @@ private:
 
   // The weight should be proportional to the number of bytes used
   const AllocWeight weight;
+
+  // The memory resource which the Alloc is in. The weight of the Alloc in
+  // the objective of the Graph is scaled by the Graph's weight of its
+  // resource, see Graph::setResourceWeight
+  const ResourceClass resource;
   std::vector<OpAddress> ops;
 };
 
@@ -6,16 +6,28 @@
 #include <array>
 #include <cmath>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <sstream>
 #include <type_traits>
 
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 namespace poprithms {
 namespace schedule {
 namespace anneal {
 
 constexpr int NAW = 7;
 
+// AllocWeights are stored in NAWPadded lanes of doubles, where the lanes at
+// and beyond NAW are always zero. With 8 lanes, an AllocWeight is exactly 2
+// AVX (or 1 AVX-512) registers wide.
+constexpr int NAWPadded = 8;
+
 // A generalization of an Alloc's size, AllocWeight is vectorized to allow for
 // lexicographic comparisons. There are NAW "characters" to compare
 // AllocWeights along, the centre of these, at (NAW - 1)/2 is used by default.
@@ -30,8 +42,17 @@ constexpr int NAW = 7;
 //
 // Using a vectorized Alloc size such as the class below avoids numerical
 // issues. Unfortunately, it is 2x slower (for recompute example with 200 Ops)
-// than using just doubles and so:
-// (TODO(T14826)) templatize for different AllocWeight.
+// than using just doubles. The ripple algorithm is therefore templatized on
+// the weight type, and doubles are used when all Allocs have weights only in
+// the centre position (see isCentreOnly).
+//
+// When AllocWeights are used, the arithmetic and comparison operators are
+// vectorized over the NAWPadded lanes. The instruction set is selected at
+// compile time (AVX-512, AVX, SSE2, or a scalar fallback), as these
+// operators are inlined into the search loops, where a runtime dispatch would
+// cost more than it saves. It is set with the CMake option POPRITHMS_SIMD.
+// The lexicographic comparisons use a movemask to find the first lane at
+// which 2 AllocWeights differ.
 //
 
 class AllocWeight {
@@ -45,25 +66,52 @@ public:
   // by default, the centre position is used.
   explicit AllocWeight(double _v_) : AllocWeight(_v_, 0) {}
 
-  AllocWeight(const std::array<double, NAW> &_v_) : v(_v_) {}
+  AllocWeight(const std::array<double, NAW> &_v_) {
+    std::copy(_v_.cbegin(), _v_.cend(), v.begin());
+    std::fill(std::next(v.begin(), NAW), v.end(), 0.);
+  }
 
   static AllocWeight zero() { return AllocWeight(0.0, 0); }
   static AllocWeight negativeOne() { return AllocWeight(-1.0, 0); }
   static AllocWeight numericMaxLimit() {
     AllocWeight w(0.0);
-    std::fill(w.v.begin(), w.v.end(), std::numeric_limits<double>::max());
+    std::fill(w.v.begin(),
+              std::next(w.v.begin(), NAW),
+              std::numeric_limits<double>::max());
     return w;
   }
 
-  bool operator==(const AllocWeight &rhs) const { return v == rhs.v; }
-  bool operator!=(const AllocWeight &rhs) const { return v != rhs.v; }
-  bool operator<(const AllocWeight &rhs) const { return v < rhs.v; }
+  bool operator==(const AllocWeight &rhs) const {
+    return firstDifferentLane(v, rhs.v) == NAWPadded;
+  }
+  bool operator!=(const AllocWeight &rhs) const { return !operator==(rhs); }
+  bool operator<(const AllocWeight &rhs) const {
+    const auto i = firstDifferentLane(v, rhs.v);
+    return i != NAWPadded && v[i] < rhs.v[i];
+  }
   bool operator<=(const AllocWeight &rhs) const { return !operator>(rhs); }
-  bool operator>(const AllocWeight &rhs) const { return v > rhs.v; }
+  bool operator>(const AllocWeight &rhs) const {
+    const auto i = firstDifferentLane(v, rhs.v);
+    return i != NAWPadded && v[i] > rhs.v[i];
+  }
   bool operator>=(const AllocWeight &rhs) const { return !operator<(rhs); }
 
   double get(uint64_t i) { return v[i]; }
 
+  // The value at the centre (default) lexicographic position
+  double getCentre() const { return v[(NAW - 1) / 2]; }
+
+  // Return true if all values, other than the one at the centre lexicographic
+  // position, are zero.
+  bool isCentreOnly() const {
+    for (uint64_t i = 0; i < NAW; ++i) {
+      if (i != (NAW - 1) / 2 && v[i] != 0.) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   AllocWeight getAbsolute() const {
     AllocWeight x = *this;
     for (uint64_t i = 0; i < NAW; ++i) {
@@ -81,22 +129,18 @@ public:
   }
 
   AllocWeight &operator-=(const AllocWeight &rhs) {
-    for (uint64_t i = 0; i < NAW; ++i) {
-      v[i] -= rhs.v[i];
-    }
+    subtractLanes(v, rhs.v);
     return *this;
   }
 
   AllocWeight &operator+=(const AllocWeight &rhs) {
-    for (uint64_t i = 0; i < NAW; ++i) {
-      v[i] += rhs.v[i];
-    }
+    addLanes(v, rhs.v);
     return *this;
   }
 
   AllocWeight &operator+=(double b) {
-    for (auto &x : v) {
-      x += b;
+    for (uint64_t i = 0; i < NAW; ++i) {
+      v[i] += b;
     }
     return *this;
   }
@@ -118,9 +162,7 @@ public:
   }
 
   AllocWeight &operator*=(double d) {
-    for (uint64_t i = 0; i < NAW; ++i) {
-      v[i] *= d;
-    }
+    scaleLanes(v, d);
     return *this;
   }
 
@@ -128,10 +170,125 @@ public:
   std::string str() const;
   void appendSerialization(std::ostream &ost) const;
 
-  std::array<double, NAW> get() const { return v; }
+  std::array<double, NAW> get() const {
+    std::array<double, NAW> x;
+    std::copy(v.cbegin(), std::next(v.cbegin(), NAW), x.begin());
+    return x;
+  }
 
 private:
-  std::array<double, NAW> v;
+  using Lanes = std::array<double, NAWPadded>;
+  Lanes v;
+
+  static void addLanes(Lanes &a, const Lanes &b) {
+#if defined(__AVX512F__)
+    _mm512_storeu_pd(
+        a.data(),
+        _mm512_add_pd(_mm512_loadu_pd(a.data()), _mm512_loadu_pd(b.data())));
+#elif defined(__AVX__)
+    for (uint64_t i = 0; i < NAWPadded; i += 4) {
+      _mm256_storeu_pd(a.data() + i,
+                       _mm256_add_pd(_mm256_loadu_pd(a.data() + i),
+                                     _mm256_loadu_pd(b.data() + i)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (uint64_t i = 0; i < NAWPadded; i += 2) {
+      _mm_storeu_pd(a.data() + i,
+                    _mm_add_pd(_mm_loadu_pd(a.data() + i),
+                               _mm_loadu_pd(b.data() + i)));
+    }
+#else
+    for (uint64_t i = 0; i < NAWPadded; ++i) {
+      a[i] += b[i];
+    }
+#endif
+  }
+
+  static void subtractLanes(Lanes &a, const Lanes &b) {
+#if defined(__AVX512F__)
+    _mm512_storeu_pd(
+        a.data(),
+        _mm512_sub_pd(_mm512_loadu_pd(a.data()), _mm512_loadu_pd(b.data())));
+#elif defined(__AVX__)
+    for (uint64_t i = 0; i < NAWPadded; i += 4) {
+      _mm256_storeu_pd(a.data() + i,
+                       _mm256_sub_pd(_mm256_loadu_pd(a.data() + i),
+                                     _mm256_loadu_pd(b.data() + i)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    for (uint64_t i = 0; i < NAWPadded; i += 2) {
+      _mm_storeu_pd(a.data() + i,
+                    _mm_sub_pd(_mm_loadu_pd(a.data() + i),
+                               _mm_loadu_pd(b.data() + i)));
+    }
+#else
+    for (uint64_t i = 0; i < NAWPadded; ++i) {
+      a[i] -= b[i];
+    }
+#endif
+  }
+
+  static void scaleLanes(Lanes &a, double d) {
+#if defined(__AVX512F__)
+    _mm512_storeu_pd(a.data(),
+                     _mm512_mul_pd(_mm512_loadu_pd(a.data()),
+                                   _mm512_set1_pd(d)));
+#elif defined(__AVX__)
+    const auto d4 = _mm256_set1_pd(d);
+    for (uint64_t i = 0; i < NAWPadded; i += 4) {
+      _mm256_storeu_pd(a.data() + i,
+                       _mm256_mul_pd(_mm256_loadu_pd(a.data() + i), d4));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const auto d2 = _mm_set1_pd(d);
+    for (uint64_t i = 0; i < NAWPadded; i += 2) {
+      _mm_storeu_pd(a.data() + i,
+                    _mm_mul_pd(_mm_loadu_pd(a.data() + i), d2));
+    }
+#else
+    for (uint64_t i = 0; i < NAWPadded; ++i) {
+      a[i] *= d;
+    }
+#endif
+  }
+
+  // The lowest index at which a and b differ, or NAWPadded if they are
+  // identical. The comparison is unordered, so NaNs are always different.
+  static uint64_t firstDifferentLane(const Lanes &a, const Lanes &b) {
+#if defined(__AVX512F__)
+    unsigned mask = _mm512_cmp_pd_mask(
+        _mm512_loadu_pd(a.data()), _mm512_loadu_pd(b.data()), _CMP_NEQ_UQ);
+#elif defined(__AVX__)
+    unsigned mask = 0;
+    for (uint64_t i = 0; i < NAWPadded; i += 4) {
+      auto neq = _mm256_cmp_pd(_mm256_loadu_pd(a.data() + i),
+                               _mm256_loadu_pd(b.data() + i),
+                               _CMP_NEQ_UQ);
+      mask |= static_cast<unsigned>(_mm256_movemask_pd(neq)) << i;
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    unsigned mask = 0;
+    for (uint64_t i = 0; i < NAWPadded; i += 2) {
+      auto neq = _mm_cmpneq_pd(_mm_loadu_pd(a.data() + i),
+                               _mm_loadu_pd(b.data() + i));
+      mask |= static_cast<unsigned>(_mm_movemask_pd(neq)) << i;
+    }
+#else
+    unsigned mask = 0;
+    for (uint64_t i = 0; i < NAWPadded; ++i) {
+      mask |= static_cast<unsigned>(!(a[i] == b[i])) << i;
+    }
+#endif
+    if (mask == 0) {
+      return NAWPadded;
+    }
+    uint64_t lane{0};
+    while ((mask & 1u) == 0) {
+      mask >>= 1;
+      ++lane;
+    }
+    return lane;
+  }
 };
 
 template <typename T> static AllocWeight operator*(T a, AllocWeight w) {
@@ -13,6 +13,13 @@ using OpAddress     = uint64_t;
 using Fraction      = double;
 using ScheduleIndex = int;
 
+// The memory resource (such as on-chip, streaming or host memory) which an
+// Alloc is in
+using ResourceClass = uint32_t;
+
+// Identifies a debug string in the StringPool of a Graph
+using DebugStringId = uint32_t;
+
 } // namespace anneal
 } // namespace schedule
 } // namespace poprithms
@@ -3,6 +3,8 @@
 #define POPRITHMS_SCHEDULE_ANNEAL_GRAPH
 
 #include <array>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <set>
 #include <tuple>
@@ -17,6 +19,11 @@
 #include <poprithms/schedule/anneal/trackentry.hpp>
 #include <poprithms/schedule/anneal/transitiveclosureoptimizations.hpp>
 #include <poprithms/schedule/transitiveclosure/transitiveclosure.hpp>
+#include <poprithms/util/compressedrows.hpp>
+#include <poprithms/util/epochset.hpp>
+#include <poprithms/util/segmenttree.hpp>
+#include <poprithms/util/span.hpp>
+#include <poprithms/util/stringpool.hpp>
 
 // Design of the schedule annealing algorithm
 // -------------------------------------------
@@ -30,16 +37,14 @@
 //   later iterations of the algorithm, so most time is spent searching for
 //   swaps
 
-// TODO(T14827) Parallelize the search for energy reducing swaps. Suggestions:
-// What the best approach is depends on whether we require the algorithm to be
-// deterministic. Assuming that we do, this is what I propose (for the search)
-// a vector of indices to process, toProcess, and a nextIndex, initialized to
-// 0 Each thread, when ready, gets nextIndex and increments it by 1.
-//
-// It processes its index, and if there an improvement, requests all searching
-// to halt. When all threads are finished their index, take the lowest index
-// improves, call it updateIndex. Apply update, and reset nextIndex to
-// updateIndex
+// - the search for energy reducing swaps is parallelized, and is
+//   deterministic: the result does not depend on the number of threads used.
+//   In each round, the Ops to process are in a (shuffled) vector. Each
+//   thread, when ready, claims the next unprocessed index of this vector.
+//   When a thread finds an improvement, it requests that no further indices
+//   are claimed. When all threads have finished their claimed indices, the
+//   improvement at the lowest index is applied, and the search resumes from
+//   the index following it. This is exactly what the serial algorithm does.
 
 namespace poprithms {
 namespace schedule {
@@ -58,14 +63,83 @@ static constexpr auto NKahnTieBreakers =
 std::ostream &operator<<(std::ostream &, KahnTieBreaker);
 KahnTieBreaker kahnTieBreaker(const std::string &);
 
+// How the temperature is lowered between the levels of the temperature phase
+// of minSumLivenessAnneal. With T0 the initial temperature and l the level,
+// GEOMETRIC : T = T0 * coolingRate^l,
+// LINEAR    : T = T0 * (1 - l / nTemperatureSteps),
+// ADAPTIVEREHEAT : as GEOMETRIC, but when a level is frozen (fewer than 2%
+//                  of liveness increasing shifts are accepted) without
+//                  improving on the best schedule seen, the temperature is
+//                  reset to half of the previous reset temperature.
+enum class CoolingSchedule { GEOMETRIC = 0, LINEAR, ADAPTIVEREHEAT, N };
+static constexpr auto NCoolingSchedules =
+    static_cast<uint64_t>(CoolingSchedule::N);
+std::ostream &operator<<(std::ostream &, CoolingSchedule);
+CoolingSchedule coolingSchedule(const std::string &);
+
+// The objective minimized by minSumLivenessAnneal, where the liveness at a
+// schedule index is the sum of the weights of the Allocs live at it.
+// SUM    : the sum of liveness over all schedule indices,
+// MAX    : the maximum liveness over all schedule indices, with ties broken
+//          by SUM,
+// HYBRID : SUM + maxWeight * MAX.
+enum class LivenessObjective { SUM = 0, MAX, HYBRID, N };
+static constexpr auto NLivenessObjectives =
+    static_cast<uint64_t>(LivenessObjective::N);
+std::ostream &operator<<(std::ostream &, LivenessObjective);
+LivenessObjective livenessObjective(const std::string &);
+
+// The state of minSumLivenessAnneal at the end of a round of the T=0 search
+struct AnnealProgress {
+  // the number of rounds completed
+  uint64_t round;
+  // the number of contiguous Ops shifted together in the round
+  int nToShift;
+  int nChangesInCurrentRound;
+  // the sum liveness of the current schedule
+  AllocWeight sumLiveness;
+  // the time spent in minSumLivenessAnneal, including the temperature phase
+  double elapsedSeconds;
+  // the number of liveness increasing shifts accepted in the temperature
+  // phase, which precedes the first round
+  uint64_t nUphillAccepted;
+};
+
+struct AnnealOptions;
+
 class Graph {
 public:
   // The Graph is grown incrementally with these functions:
 
-  // Create an Alloc
-  AllocAddress insertAlloc(AllocWeight w);
+  // Create an Alloc, in the memory resource r
+  AllocAddress insertAlloc(AllocWeight w, ResourceClass r = 0);
+
+  AllocAddress insertAlloc(double w, ResourceClass r = 0) {
+    return insertAlloc({w, 0}, r);
+  }
 
-  AllocAddress insertAlloc(double w) { return insertAlloc({w, 0}); }
+  // The weight of a memory resource in the objective. The liveness of the
+  // Graph, which minSumLivenessAnneal minimizes, is the sum over resources
+  // of the resource weight times the liveness of the resource's Allocs. The
+  // default weight of every resource is 1. This must be called before the
+  // Graph is initialized.
+  void setResourceWeight(ResourceClass, double);
+  double getResourceWeight(ResourceClass r) const {
+    return r < resourceWeights.size() ? resourceWeights[r] : 1.0;
+  }
+
+  // One more than the largest ResourceClass of an Alloc, or 1 if there are
+  // no Allocs
+  uint64_t nResourceClasses() const;
+
+  // The weight of an Alloc in the liveness of the Graph, which is its weight
+  // times the weight of its resource
+  AllocWeight getAllocWeight(AllocAddress a) const {
+    return resourceWeights.empty()
+               ? getAlloc(a).getWeight()
+               : getResourceWeight(getAlloc(a).getResourceClass()) *
+                     getAlloc(a).getWeight();
+  }
 
   // Create an Op, return its OpAddress
   OpAddress insertOp(const std::string &dbString);
@@ -90,6 +164,47 @@ public:
   // can be executed between "before" and "after"
   void insertLink(OpAddress before, OpAddress after);
 
+  // Defer the detection of duplicate constraints until finalize(). By
+  // default, insertConstraint and insertLink check whether a constraint
+  // already exists, which is linear in the number of outs of an Op if its
+  // outs have not been inserted in ascending order. This is quadratic when
+  // growing Graphs with high fan-out, such as weight update Ops with
+  // thousands of consumers. In deferred mode, duplicate constraints are
+  // stored, and are all removed in a single sort of each Op in finalize(),
+  // which also ends deferred mode. Until then, nConstraints() includes
+  // duplicates. Deferred mode cannot be started once the Graph is
+  // initialized.
+  void deferDeduplication();
+  bool isDeferringDeduplication() const { return deferringDeduplication; }
+
+  // Reserve memory for nOps Ops and nAllocs Allocs, for when the final size
+  // of a Graph which is grown incrementally is known in advance
+  void reserve(uint64_t nOps, uint64_t nAllocs);
+
+  // Construct a finalized Graph in a single pass from arrays in compressed
+  // sparse row (CSR) format, which is much faster than growing a large
+  // Graph incrementally. There are outOffsets.size() - 1 Ops, and
+  // allocWeights.size() Allocs.
+  //
+  // outOffsets, outs : the Ops which must execute after Op i are
+  //                    outs[outOffsets[i]], ..., outs[outOffsets[i+1] - 1].
+  // allocOffsets, allocs : the Allocs which must be live when Op i executes
+  //                        are allocs[allocOffsets[i]], ...,
+  //                        allocs[allocOffsets[i+1] - 1].
+  // opNames : the debug strings of the Ops. If empty, all Ops have an empty
+  //           debug string.
+  //
+  // Rows may contain duplicates and need not be sorted. An error is thrown
+  // if the offsets are not non-decreasing from 0 to the number of targets,
+  // or if any target is out of range.
+  static Graph
+  fromCompressedRows(const std::vector<uint64_t> &outOffsets,
+                     const std::vector<OpAddress> &outs,
+                     const std::vector<uint64_t> &allocOffsets,
+                     const std::vector<AllocAddress> &allocs,
+                     const std::vector<AllocWeight> &allocWeights,
+                     const std::vector<std::string> &opNames = {});
+
   // The above methods are combined in some convenience methods:
   template <typename A, typename B>
   OpAddress insertOp(A &&befores, B &&allocs, const std::string &dbString) {
@@ -111,23 +226,67 @@ public:
                     dbString);
   }
 
+  // The Graph can also be edited after it has been initialized, with the
+  // methods above and those below. Edits to an initialized Graph are not
+  // reflected in its schedule until updateSchedule is called, and
+  // minSumLivenessAnneal cannot be called while there are pending edits.
+  //
+  // An error is thrown on any edit after the Graph has been initialized with
+  // TransitiveClosureOptimizations. These remove redundant constraints, and
+  // insert constraints and links which are only justified by the Graph as
+  // it was, and which the Graph keeps if it is initialized again. To edit
+  // such a Graph, edit a copy taken before it was initialized.
+
+  // Remove the constraint "before" -> "after", which must exist, and must not
+  // be a link
+  void removeConstraint(OpAddress before, OpAddress after);
+
+  // Remove all constraints, links and Allocs of an Op. The Op itself remains
+  // in the Graph, isolated, so that OpAddresses are not changed
+  void removeOp(OpAddress);
+
+  // Remove an Alloc from all of its Ops. As with removeOp, the Alloc remains
+  // in the Graph so that AllocAddresses are not changed
+  void removeAlloc(AllocAddress);
+
+  bool hasPendingEdits() const { return !editedOps.empty(); }
+
+  // Splice the pending edits into the current schedule, and then re-anneal
+  // the neighbourhood of the edits. The spliced schedule is obtained with
+  // Kahn's algorithm, where ready Ops are scheduled in the order in which
+  // they appear in the current schedule, with new Ops scheduled as soon as
+  // they are ready. Annealing is only applied to Ops which are edited, are
+  // connected to edited Ops, or have been moved by splicing. This region
+  // grows as Ops are shifted, as with filterSusceptible.
+  //
+  // annealOptions : passed to minSumLivenessAnneal, except for
+  // filterSusceptible, which is always true.
+  void
+  updateSchedule(const std::map<std::string, std::string> &annealOptions);
+
   // A new Graph can be generated by merging groups of Ops in this
   // Graph into single Ops. The method below does this. The returned tuple
   // consists of (1) the reduced Graph, containing merged Ops and (2) a
   // mapping from the Ops in the reduced (child) Graph to Ops in this
   // (the parent) Graph.
+  //
+  // If withDebugStrings is true, the debug string of a child Op is the
+  // concatenation of the debug strings of its parents, "(a b c)". Otherwise
+  // it is empty, which is much faster for large Graphs, and is used for all
+  // child Graphs which are generated internally.
   using ParentGraphOps = std::vector<std::vector<OpAddress>>;
   using OpMerged       = std::tuple<Graph, ParentGraphOps>;
-  OpMerged getMerged(std::vector<std::vector<OpAddress>> chains) const;
+  OpMerged getMerged(std::vector<std::vector<OpAddress>> chains,
+                     bool withDebugStrings = true) const;
 
   // Merges all chains formed of Ops with Links
   // Recall : linked Ops are guarenteed to be scheduled contiguously.
-  OpMerged getLinkMerged() const;
+  OpMerged getLinkMerged(bool withDebugStrings = true) const;
 
   // Merges all chains formed of tightly paired Ops
   // Recall : two Ops are said to be tightly paired if one is the unique
   // output of the other, which in turn is the unique input of the first.
-  OpMerged getTightMerged() const;
+  OpMerged getTightMerged(bool withDebugStrings = true) const;
 
   static Graph fromSerializationString(const std::string &);
   void appendSerialization(std::ostream &) const;
@@ -140,6 +299,13 @@ public:
   uint64_t nOps() const { return allOps.size(); }
   int nOps_i32() const { return static_cast<int>(nOps()); }
 
+  // Debug strings are interned: each distinct debug string is stored once in
+  // the Graph, and Ops only store a DebugStringId.
+  const std::string &getDebugString(OpAddress address) const {
+    return debugStrings.get(getOp(address).getDebugStringId());
+  }
+  const util::StringPool &getDebugStrings() const { return debugStrings; }
+
   // The total number of constraints
   uint64_t nConstraints() const;
 
@@ -158,6 +324,13 @@ public:
 
   void initialize(const std::map<std::string, std::string> &);
 
+  // Initialize from a schedule of all Ops, instead of running Kahn's
+  // algorithm. This is useful for warm-starting minSumLivenessAnneal from a
+  // previously annealed schedule. An error is thrown if the schedule is not
+  // a permutation of all Ops, or if it does not satisfy all constraints and
+  // links.
+  void initialize(const std::vector<OpAddress> &schedule);
+
   // Should be called once after the final call to a growing member. Sorts
   // certain Op member ids to accelerate the annealing algorithm
   void finalize();
@@ -174,6 +347,22 @@ public:
   static bool defaultFilterSusceptible() { return true; }
   static double defaultTimeLimitSeconds() { return 1e9; }
   static int64_t defaultSwapLimitCount() { return static_cast<int64_t>(1e9); }
+  static uint32_t defaultNThreads() { return 1; }
+  static double defaultInitialTemperature() { return 0.0; }
+  static CoolingSchedule defaultCoolingSchedule() {
+    return CoolingSchedule::GEOMETRIC;
+  }
+  static uint32_t defaultNTemperatureSteps() { return 20; }
+  static double defaultCoolingRate() { return 0.8; }
+  static LivenessObjective defaultLivenessObjective() {
+    return LivenessObjective::SUM;
+  }
+  static double defaultMaxWeight() { return 1.0; }
+  static uint64_t defaultNTabuIterations() { return 0; }
+  static uint32_t defaultTabuTenure() { return 10; }
+  static double defaultTargetGapPercent() { return -1.0; }
+  static uint64_t defaultWindowSize() { return 0; }
+  static uint64_t maxWindowSize() { return 16; }
 
   static KahnTieBreaker defaultKahnTieBreaker() {
     return KahnTieBreaker::GREEDY;
@@ -209,52 +398,216 @@ public:
   // shift, only considershifts of ranges if at least one Op in the
   // range has a constraint to an Op which moved in the previous round.
   // Changing this boolean value may change the final local minimum found
-
-  void
-  minSumLivenessAnneal(MinSumLivenessAlgo algo = MinSumLivenessAlgo::RIPPLE,
-                       bool debug              = defaultDebug(),
-                       uint32_t seed           = defaultMinSumLivenessSeed(),
-                       bool filterSusceptible  = defaultFilterSusceptible(),
-                       double timeLimitSeconds = defaultTimeLimitSeconds(),
-                       int64_t swapLimitCount  = defaultSwapLimitCount());
+  //
+  // nThreads : the number of threads used to search for shifts. The final
+  // schedule does not depend on the number of threads
+  //
+  // initialTemperature : if positive, the T=0 search described above is
+  // preceded by a temperature phase of nTemperatureSteps levels. In each
+  // level, every Op is proposed a random valid 1-shift, which is accepted
+  // with the Metropolis probability exp(-cost / T), where cost is the change
+  // in the centre lexicographic weight of sum liveness. Shifts which
+  // increase liveness in a lexicographic position of higher priority than
+  // the centre are never accepted. The temperature phase uses at most half
+  // of timeLimitSeconds and swapLimitCount, the remainder is left for the
+  // T=0 search, which always follows. This requires the RIPPLE algorithm
+  //
+  // coolingSchedule, nTemperatureSteps, coolingRate : how the temperature is
+  // lowered from initialTemperature, see CoolingSchedule
+  //
+  // objective, maxWeight : the objective minimized by the T=0 search, see
+  // LivenessObjective. The temperature phase always minimizes SUM. For MAX
+  // and HYBRID, the change in the maximum liveness of every candidate shift
+  // is evaluated with a SegmentTree over the liveness of each schedule
+  // index. This requires the RIPPLE algorithm
+  //
+  // nTabuIterations, tabuTenure : if nTabuIterations is positive, the T=0
+  // search is followed by a tabu phase, which escapes the local minimum
+  // found. In each of its nTabuIterations iterations, the valid 1-shift with
+  // the lowest cost is applied, even if it increases liveness, and then
+  // improving 1-shifts are applied until there are none. An Op which was
+  // shifted in an iteration is tabu for the following tabuTenure
+  // iterations: it is not shifted, unless that gives a schedule better than
+  // the best seen. The best schedule seen is installed at the end. The tabu
+  // phase minimizes SUM, and so requires the SUM objective. It uses the
+  // time and swaps remaining after the T=0 search
+  //
+  // targetGapPercent : if non-negative, annealing stops as soon as the sum
+  // liveness is within targetGapPercent percent of
+  // getSumLivenessLowerBound(), as no schedule can then be much better. The
+  // bound is computed once, at the start. A negative value disables this.
+  // It requires the SUM objective
+  //
+  // windowSize : if at least 2, the T=0 search is followed by a window
+  // phase, which precedes the tabu phase. The schedule is divided into
+  // windows of windowSize consecutive schedule indices, and the Ops of each
+  // window are reordered to minimize sum liveness exactly, with dynamic
+  // programming over the subsets of the window. This finds improvements
+  // which need several Ops to move at once. Windows are solved concurrently
+  // on nThreads threads, and the windows are offset by windowSize / 2 in
+  // alternate sweeps, until 2 consecutive sweeps make no change. Windows
+  // with linked Ops are not reordered. The cost of a window is
+  // O(2^windowSize * windowSize), so windowSize is at most maxWindowSize().
+  // It requires the SUM objective
+
+  void minSumLivenessAnneal(
+      MinSumLivenessAlgo algo         = MinSumLivenessAlgo::RIPPLE,
+      bool debug                      = defaultDebug(),
+      uint32_t seed                   = defaultMinSumLivenessSeed(),
+      bool filterSusceptible          = defaultFilterSusceptible(),
+      double timeLimitSeconds         = defaultTimeLimitSeconds(),
+      int64_t swapLimitCount          = defaultSwapLimitCount(),
+      uint32_t nThreads               = defaultNThreads(),
+      double initialTemperature       = defaultInitialTemperature(),
+      CoolingSchedule coolingSchedule = defaultCoolingSchedule(),
+      uint32_t nTemperatureSteps      = defaultNTemperatureSteps(),
+      double coolingRate              = defaultCoolingRate(),
+      LivenessObjective objective     = defaultLivenessObjective(),
+      double maxWeight                = defaultMaxWeight(),
+      uint64_t nTabuIterations        = defaultNTabuIterations(),
+      uint32_t tabuTenure             = defaultTabuTenure(),
+      double targetGapPercent         = defaultTargetGapPercent(),
+      uint64_t windowSize             = defaultWindowSize());
 
   void minSumLivenessAnneal(const std::map<std::string, std::string> &);
 
+  // As above, with the additional options progressCallback and cancel, see
+  // AnnealOptions
+  void minSumLivenessAnneal(const AnnealOptions &);
+
+  // Multi-start annealing. nStarts copies of this initialized Graph are
+  // re-initialized and annealed, concurrently on nThreads threads. Start i
+  // uses KahnTieBreaker i % NKahnTieBreakers, and seed + i as both the Kahn
+  // seed and the annealing seed. All starts share a wall-clock budget of
+  // timeLimitSeconds: a start which begins after the budget is exhausted is
+  // skipped, unless it is start 0. The schedule with the lowest sum liveness
+  // (the lowest start index in case of ties) is installed in this Graph.
+  //
+  // annealOptions : passed to minSumLivenessAnneal for every start, and so
+  // may not contain seed, timeLimitSeconds or nThreads
+  void minSumLivenessAnnealPortfolio(
+      uint64_t nStarts,
+      uint32_t nThreads,
+      uint32_t seed,
+      double timeLimitSeconds,
+      const std::map<std::string, std::string> &annealOptions);
+
+  // Multilevel annealing. This initialized Graph is repeatedly coarsened
+  // with getMerged, first merging linked Ops, and then tightly paired Ops and
+  // a matching of the remaining Ops along constraints, preferring pairs
+  // which share the greatest Alloc weight. Coarsening stops when a Graph has
+  // at most coarsestNOps Ops, or when a coarsening removes fewer than 10% of
+  // the Ops. The coarsest Graph is initialized with Kahn's algorithm and
+  // annealed. Its schedule is then expanded to the next finer Graph, and
+  // used as the initial schedule for annealing it, and so on up to this
+  // Graph.
+  //
+  // annealOptions : passed to minSumLivenessAnneal at every level
+  void minSumLivenessAnnealMultilevel(
+      uint64_t coarsestNOps,
+      const std::map<std::string, std::string> &annealOptions);
+
+  // Anneal each connected component (see getComponents) of this initialized
+  // Graph as an independent Graph, concurrently on nThreads threads. The
+  // initial schedule of a component is its Ops in the order of the current
+  // schedule. No Alloc is live between components in a concatenation of the
+  // component schedules, and so for non-negative Alloc weights, the sum (and
+  // max) liveness of the concatenation is the lowest of all interleavings.
+  // The components are concatenated in the order of getComponents.
+  //
+  // annealOptions : passed to minSumLivenessAnneal for every component
+  void minSumLivenessAnnealComponents(
+      uint32_t nThreads,
+      const std::map<std::string, std::string> &annealOptions);
+
+  // The liveness is maintained as the schedule changes, and so these are
+  // valid at any point after initialization, including during annealing.
+  // getSumLiveness is O(1), and getMaxLiveness and scheduleToLiveness are
+  // O(log(nOps)).
   AllocWeight getMaxLiveness() const;
 
   AllocWeight getSumLiveness() const;
 
+  // The sum and max over schedule indices of the liveness of the Allocs in
+  // one memory resource, with the Alloc weights not scaled by the resource
+  // weight. These are O(nOps + nAllocs).
+  AllocWeight getSumLiveness(ResourceClass) const;
+  AllocWeight getMaxLiveness(ResourceClass) const;
+
+  // A lower bound on getSumLiveness() over all valid schedules, which does
+  // not require the Graph to be initialized. It is the larger of 2 bounds,
+  // both from the TransitiveClosure: (1) the sum over Allocs of the weight
+  // times the fewest schedule indices the Alloc can be live for. These are
+  // its Ops, the Ops which must be after one of its Ops and before another,
+  // and the gap between the earliest and latest possible schedule indices
+  // of its Ops. (2) For non-negative weights, the sum over schedule indices
+  // of the liveness, when each Op changes the liveness by its lowest
+  // possible change, and Ops with the lowest changes are scheduled first.
+  // The TransitiveClosure built by initialize is used if there is one,
+  // otherwise one is built, which is O(nOps^2) in memory.
+  AllocWeight getSumLivenessLowerBound() const;
+
+  // An optional hard cap on the liveness at every schedule index, such as
+  // the memory available on chip. With a cap, Kahn's algorithm in
+  // initialize schedules a ready Op which keeps the liveness at most the
+  // cap whenever there is one, and otherwise the ready Op with the lowest
+  // liveness. Every phase of minSumLivenessAnneal rejects shifts which make
+  // the liveness in the shifted range exceed both the cap and the maximum
+  // in the range before the shift, so a schedule which meets the cap
+  // continues to meet it. If the cap is not met when annealing ends, an
+  // error describing the first range of schedule indices where it is
+  // exceeded is thrown, and the Graph keeps the annealed schedule.
+  //
+  // The cap is on the liveness of the Graph, not of each memory resource,
+  // and so is only supported for Graphs with a single ResourceClass. An
+  // error is thrown by setLivenessCap, and by initialize and
+  // minSumLivenessAnneal with a cap, if there is more than one.
+  void setLivenessCap(AllocWeight cap) {
+    assertSingleResourceClass();
+    livenessCap    = cap;
+    livenessCapped = true;
+  }
+  void setLivenessCap(double cap) { setLivenessCap({cap, 0}); }
+  void removeLivenessCap() { livenessCapped = false; }
+  bool hasLivenessCap() const { return livenessCapped; }
+  const AllocWeight &getLivenessCap() const { return livenessCap; }
+
+  // The maximal ranges [start, end) of schedule indices at which the
+  // liveness exceeds the cap, in schedule order. Empty if there is no cap.
+  std::vector<std::array<ScheduleIndex, 2>> getLivenessCapViolations() const;
+
   AllocWeight scheduleToLiveness(ScheduleIndex i) const {
-    return schToLiveness[static_cast<uint64_t>(i)];
+    return schToLiveness.at(static_cast<uint64_t>(i));
   }
   OpAddress scheduleToOp(ScheduleIndex i) const {
     return schToOp[static_cast<uint64_t>(i)];
   }
   ScheduleIndex opToSchedule(OpAddress a) const { return opToSch[a]; }
 
-  // sorted schedule indices at which alloc is used
-  const std::vector<ScheduleIndex> &allocToSchedule(AllocAddress a) const {
+  // sorted schedule indices at which alloc is used. The returned Span is
+  // invalidated by any change to the schedule.
+  util::Span<const ScheduleIndex> allocToSchedule(AllocAddress a) const {
     return allocToSch[a];
   }
   ScheduleIndex allocToFirstSchedule(AllocAddress a) const {
-    return allocToSch[a][0];
+    return allocToSch[a].front();
   }
   ScheduleIndex allocToFinalSchedule(AllocAddress a) const {
     return allocToSch[a].back();
   }
 
   // the allocs required by the op at a schedule index
-  const std::vector<AllocAddress> &scheduleToAllocs(ScheduleIndex i) const {
+  util::Span<const AllocAddress> scheduleToAllocs(ScheduleIndex i) const {
     return schToAllocs[static_cast<uint64_t>(i)];
   }
 
   // schedule indices of an ops inputs, sorted
-  const std::vector<ScheduleIndex> &opToInSchedule(OpAddress a) const {
+  util::Span<const ScheduleIndex> opToInSchedule(OpAddress a) const {
     return opToInSch[a];
   }
 
   // schedule indices of an ops output, sorted
-  const std::vector<ScheduleIndex> &opToOutSchedule(OpAddress a) const {
+  util::Span<const ScheduleIndex> opToOutSchedule(OpAddress a) const {
     return opToOutSch[a];
   }
 
@@ -279,9 +632,9 @@ public:
   void insertAttractions(const std::vector<std::array<OpAddress, 2>> &pairs,
                          AllocWeight w);
 
-  bool operator==(const Graph &rhs) const {
-    return allOps == rhs.allOps && allAllocs == rhs.allAllocs;
-  }
+  // Graphs are equal if their Ops, debug strings and Allocs are equal. The
+  // DebugStringIds of Ops need not be equal.
+  bool operator==(const Graph &rhs) const;
   bool operator!=(const Graph &rhs) const { return !operator==(rhs); }
 
   // A pair of Ops (a,b) is defined to be a "tight pair" if
@@ -315,9 +668,68 @@ private:
   template <typename T>
   ScheduleIndex getExtremaIndexWithNonUniqueSolution() const;
 
-  void kahn(KahnTieBreaker, uint32_t kahnSeed);
-  void removeConstraint(OpAddress before, OpAddress after);
+  std::vector<OpAddress> kahn(KahnTieBreaker, uint32_t kahnSeed) const;
+
+  // Kahn's algorithm with the liveness cap, see setLivenessCap. Ready Ops
+  // are ordered as in kahn(KahnTieBreaker, uint32_t), amongst those which
+  // keep the liveness at most the cap.
+  std::vector<OpAddress> kahnCapped(KahnTieBreaker, uint32_t kahnSeed) const;
+
+  AllocWeight livenessCap{0};
+  bool livenessCapped{false};
+
+  // Empty if no resource weight has been set
+  std::vector<double> resourceWeights;
+
+  // The liveness of the Allocs of a memory resource at each schedule index
+  std::vector<AllocWeight> getResourceLiveness(ResourceClass) const;
 
+  // Throw an error if the liveness exceeds the cap anywhere in the schedule
+  void assertLivenessCapMet() const;
+
+  // Throw an error if there is more than one ResourceClass, for which the
+  // liveness cap is not supported
+  void assertSingleResourceClass() const;
+
+  // Kahn's algorithm, where the ready Op with the lowest priority value is
+  // scheduled first
+  std::vector<OpAddress> kahn(const std::vector<uint64_t> &priorities) const;
+
+  // Ops edited since the last schedule update, only recorded once the Graph
+  // is initialized. The edits made by initialize itself are not recorded, as
+  // it clears isInitialized.
+  std::vector<OpAddress> editedOps;
+  void registerEdit(OpAddress a) {
+    if (isInitialized) {
+      editedOps.push_back(a);
+    }
+  }
+
+  // A Graph initialized with TransitiveClosureOptimizations cannot be
+  // edited. The error thrown on an edit of it describes the edit.
+  bool isEditable() const {
+    return !isInitialized || !isTransitiveClosureOptimized;
+  }
+  void throwNotEditable(const std::string &edit) const;
+
+  void discardTransitiveClosure() {
+    if (!lowerBoundChange.empty()) {
+      transitiveClosure = transitiveclosure::TransitiveClosure({});
+      lowerBoundChange.clear();
+      upperBoundChange.clear();
+    }
+  }
+
+  // If not empty, the Ops which are susceptible at the start of annealing
+  // and after every clean slate, in place of all Ops. Set by updateSchedule
+  std::vector<bool> annealRegion;
+
+  // Throw an error if the schedule is not valid for this Graph, see
+  // initialize(const std::vector<OpAddress> &)
+  void assertValidSchedule(const std::vector<OpAddress> &) const;
+
+  // Set schToOp, and all schedule dependant members derived from it
+  void setSchedule(std::vector<OpAddress> &&);
   void confirmShiftAndCost(ScheduleIndex start0,
                            int nToShift,
                            const ShiftAndCost &shiftAndCost,
@@ -336,47 +748,222 @@ private:
   // unchanged after initialization: never updated
   std::vector<Op> allOps;
   std::vector<Alloc> allAllocs;
+  util::StringPool debugStrings;
 
   // updated EVERY time the schedule changes
   std::vector<OpAddress> schToOp;
   std::vector<ScheduleIndex> opToSch;
-  std::vector<std::vector<ScheduleIndex>> allocToSch;
-  std::vector<std::vector<AllocAddress>> schToAllocs;
-  std::vector<std::vector<ScheduleIndex>> opToInSch;
-  std::vector<std::vector<ScheduleIndex>> opToOutSch;
+  // Stored in CSR format, so that the ripple search walks contiguous memory.
+  // The row lengths of allocToSch, opToInSch and opToOutSch never change,
+  // and the rows of schToAllocs are only ever rotated.
+  util::CompressedRows<ScheduleIndex> allocToSch;
+  util::CompressedRows<AllocAddress> schToAllocs;
+  util::CompressedRows<ScheduleIndex> opToInSch;
+  util::CompressedRows<ScheduleIndex> opToOutSch;
   std::vector<int> nCanFwd;
   std::vector<int> nCanBwd;
+  // Ops which may have an improving shift, flagged in susceptible and
+  // listed once each in susceptibleList, so that a round only visits the
+  // Ops near recent changes.
   std::vector<bool> susceptible;
-
-  // not updated every time the schedule changes
-  std::vector<AllocWeight> schToLiveness;
-
-  std::vector<AllocWeight> getRippleCosts(ScheduleIndex start0,
+  std::vector<OpAddress> susceptibleList;
+
+  // The liveness at each of the nOps() + 1 schedule indices, where the
+  // final index is after all Ops, and so has liveness 0. Range updates are
+  // made to it in applyChange.
+  util::SegmentTree<AllocWeight> schToLiveness;
+  AllocWeight sumLiveness{0};
+
+  // The ripple algorithm accumulates Alloc weights of type W, which is
+  // either AllocWeight or double. Using double is about twice as fast, and
+  // is possible when all Allocs have non-zero weight only in the centre
+  // lexicographic position. The type is selected in minSumLivenessAnneal.
+  //
+  // How the first and final schedule indices of an Alloc change when a
+  // ScheduleChange is applied
+  struct IntervalChange {
+    AllocAddress alloc;
+    ScheduleIndex first0;
+    ScheduleIndex final0;
+    ScheduleIndex first1;
+    ScheduleIndex final1;
+  };
+
+  // The buffers of the evaluation of the liveness of a shift in a range of
+  // the schedule, see getRangeMaxima
+  struct PeakScratch {
+    // The Allocs of a range of the schedule, see getAllocAddresses
+    util::EpochSet allocs;
+    std::vector<IntervalChange> changes;
+    std::vector<std::tuple<ScheduleIndex, AllocWeight>> events;
+  };
+
+  // The ripple algorithm uses a scratchpad with one TrackEntry per Alloc.
+  // When searching with multiple threads, each thread has its own. All of
+  // its buffers are reused, so that the search for shifts does not allocate.
+  template <typename W> struct RippleScratch : PeakScratch {
+    std::vector<TrackEntry<W>> entries;
+    // The Allocs whose entries are live
+    std::vector<AllocAddress> liveAllocs;
+    // The costs computed by the most recent call to getRippleCosts
+    std::vector<W> costs;
+    // The shifts found by the most recent call to getAllShiftsRippleAlgo
+    std::vector<ShiftAndCost> shifts;
+  };
+
+  template <typename W> RippleScratch<W> getInitialRippleScratch() const;
+
+  template <typename W> W getRippleWeight(AllocAddress) const;
+
+  template <typename W>
+  const std::vector<W> &getRippleCosts(ScheduleIndex start0,
+                                       int nToShift,
+                                       int sign,
+                                       int nCostsToCompute,
+                                       int dirOffset,
+                                       RippleScratch<W> &) const;
+
+  template <typename W>
+  const std::vector<W> &getFwdRippleCosts(ScheduleIndex start,
                                           int nToShift,
-                                          int sign,
-                                          int nCostsToCompute,
-                                          int dirOffset) const;
-
-  std::vector<AllocWeight>
-  getFwdRippleCosts(ScheduleIndex start, int nToShift, int firstExtCon) const;
+                                          int firstExtCon,
+                                          RippleScratch<W> &) const;
 
-  std::vector<AllocWeight> getBwdRippleCosts(ScheduleIndex start0,
-                                             int nToShift,
-                                             int lastExtProd) const;
+  template <typename W>
+  const std::vector<W> &getBwdRippleCosts(ScheduleIndex start0,
+                                          int nToShift,
+                                          int lastExtProd,
+                                          RippleScratch<W> &) const;
 
+  template <typename W>
   ShiftAndCost getBestShiftRippleAlgo(const ScheduleIndex start,
-                                      const int nToShift) const;
+                                      const int nToShift,
+                                      RippleScratch<W> &) const;
 
   ShiftAndCost getBestShiftSimpleAlgo(const ScheduleIndex start,
                                       const int nToShift) const;
 
-  AllocWeight getShiftCost(ScheduleIndex start0,
-                           ScheduleIndex start1,
-                           int nToShift,
-                           const Alloc &) const;
+  // All valid shifts of the nToShift Ops starting at start, with their
+  // costs, whether or not they reduce liveness. They are in the scratchpad,
+  // and so valid until its next use.
+  template <typename W>
+  const std::vector<ShiftAndCost> &
+  getAllShiftsRippleAlgo(const ScheduleIndex start,
+                         const int nToShift,
+                         RippleScratch<W> &) const;
+
+  // The Allocs whose intervals change when the schedule ranges [x0, o0) and
+  // [o0, o1) are swapped. They are in the scratchpad, and so valid until its
+  // next use.
+  const std::vector<IntervalChange> &
+  getIntervalChanges(ScheduleIndex x0,
+                     ScheduleIndex o0,
+                     ScheduleIndex o1,
+                     PeakScratch &) const;
+
+  // The change in the maximum liveness when the schedule ranges [x0, o0) and
+  // [o0, o1) are swapped
+  AllocWeight getPeakChange(ScheduleIndex x0,
+                            ScheduleIndex o0,
+                            ScheduleIndex o1,
+                            PeakScratch &) const;
+
+  // The maximum liveness in [x0, o1), before and after the schedule ranges
+  // [x0, o0) and [o0, o1) are swapped
+  std::array<AllocWeight, 2> getRangeMaxima(ScheduleIndex x0,
+                                            ScheduleIndex o0,
+                                            ScheduleIndex o1,
+                                            PeakScratch &) const;
+
+  // True if the liveness cap rejects the ScheduleChange, see
+  // setLivenessCap. False if there is no cap.
+  bool exceedsLivenessCap(const ScheduleChange &, PeakScratch &) const;
+
+  // Update the liveness for a change to the interval of an Alloc, which was
+  // [first0, final0] before the change, and is now in allocToSch
+  void updateLiveness(AllocAddress,
+                      ScheduleIndex first0,
+                      ScheduleIndex final0);
+
+  // The best shift for the MAX and HYBRID objectives, where the returned
+  // cost is negative if and only if the shift is an improvement. The change
+  // in sum liveness of the returned shift is written to sumCost.
+  template <typename W>
+  ShiftAndCost getBestShiftPeakAlgo(const ScheduleIndex start,
+                                    const int nToShift,
+                                    LivenessObjective objective,
+                                    double maxWeight,
+                                    RippleScratch<W> &,
+                                    AllocWeight &sumCost) const;
+
+  // The best shift for the SUM objective amongst those which the liveness
+  // cap does not reject
+  template <typename W>
+  ShiftAndCost getBestShiftCappedAlgo(const ScheduleIndex start,
+                                      const int nToShift,
+                                      RippleScratch<W> &) const;
+
+  // The Graph of the connected component "component", where Op i is
+  // component[i]. localOps maps every Op to its index in its component, and
+  // localAllocs maps every Alloc to its index in its component, where Allocs
+  // are ordered by their first appearance in the Ops of the component.
+  Graph getComponentGraph(const std::vector<OpAddress> &component,
+                          const std::vector<uint64_t> &localOps,
+                          const std::vector<uint64_t> &localAllocs) const;
+
+  // The temperature phase of minSumLivenessAnneal. The change in sum
+  // liveness of every accepted shift is added to totalDeltaSumLiveness, the
+  // number of accepted shifts to nChangesInTotal, and the number of those
+  // which increase liveness to nUphillAcceptedInTotal.
+  template <typename W>
+  void temperatureAnneal(const AnnealOptions &,
+                         AllocWeight &totalDeltaSumLiveness,
+                         int64_t &nChangesInTotal,
+                         uint64_t &nUphillAcceptedInTotal);
+
+  // The tabu phase of minSumLivenessAnneal, with at most timeLimitSeconds
+  // and swapLimitCount. The change in sum liveness is added to
+  // totalDeltaSumLiveness, and the number of shifts to nChangesInTotal.
+  template <typename W>
+  void tabuSearch(const AnnealOptions &,
+                  double timeLimitSeconds,
+                  int64_t swapLimitCount,
+                  AllocWeight &totalDeltaSumLiveness,
+                  int64_t &nChangesInTotal);
+
+  // The window phase of minSumLivenessAnneal, with the same arguments as
+  // tabuSearch. Each reordered window is applied as a sequence of 1-shifts.
+  void windowSearch(const AnnealOptions &,
+                    double timeLimitSeconds,
+                    int64_t swapLimitCount,
+                    AllocWeight &totalDeltaSumLiveness,
+                    int64_t &nChangesInTotal);
+
+  template <typename W>
+  W getShiftCost(ScheduleIndex start0,
+                 ScheduleIndex start1,
+                 int nToShift,
+                 AllocAddress) const;
+
+  // The centre lexicographic weight of each Alloc, if all Allocs have
+  // non-zero weight only in the centre lexicographic position. Otherwise,
+  // empty.
+  std::vector<double> scalarAllocWeights;
+  void setScalarAllocWeights();
+  bool hasScalarAllocWeights() const {
+    return nAllocs() == 0 || !scalarAllocWeights.empty();
+  }
+
+  // Set allocs to the Allocs of the Ops in the schedule range [start, end),
+  // in order of first appearance
+  void getAllocAddresses(ScheduleIndex start,
+                         ScheduleIndex end,
+                         util::EpochSet &allocs) const;
 
-  std::vector<AllocAddress> getAllocAddresses(ScheduleIndex start,
-                                              ScheduleIndex end) const;
+  // Workspaces of applyChange, reused so that it does not allocate
+  util::EpochSet applyChangeAllocs;
+  util::EpochSet applyChangeConsumers;
+  util::EpochSet applyChangeProducers;
 
   std::vector<AllocWeight> getDeltaLiveness() const;
 
@@ -405,12 +992,12 @@ private:
   // Susceptible Ops are Ops in (out) the range [rangeStart, rangeEnd] which
   // have a dependency outside the range
   void updateSusceptible(ScheduleIndex rangeStart, ScheduleIndex rangeEnd);
-
-  // TODO(T14827) for multithreading, need one of these scratchpads per thread
-  mutable std::vector<TrackEntry> rippleScratch;
+  void setSusceptible(OpAddress);
 
   bool isFinalized{false};
   bool isInitialized{false};
+  bool isTransitiveClosureOptimized{false};
+  bool deferringDeduplication{false};
 
   // The unique OpAddresses of Ops which have a forward link
   std::vector<OpAddress> opsWithFwdLinks;
@@ -428,6 +1015,17 @@ public:
   // Combine all tight Op pairs to form sets of isolated chains
   std::vector<std::vector<OpAddress>> getTightChains() const;
 
+  // The connected components of this Graph, where Ops are connected by
+  // constraints and by sharing an Alloc. Each component is sorted, and the
+  // components are sorted by their lowest OpAddress.
+  std::vector<std::vector<OpAddress>> getComponents() const;
+
+  // The tight chains, and a matching of the remaining Ops into pairs (a, b),
+  // where b is an output of a. To guarantee that merging creates no cycles,
+  // either b is the only output of a, or a is the only input of b. This
+  // Graph must not have links.
+  std::vector<std::vector<OpAddress>> getCoarseningChains() const;
+
   bool hasAtLeastOneLink() const { return !opsWithFwdLinks.empty(); }
 
   // insert a proxy Op, which is constrained to be scheduled very early, and
@@ -480,7 +1078,7 @@ public:
         auto allocAddress = insertAlloc(w);
 
         std::string attractorStr{"priorityAttractor_" +
-                                 getOp(opAddress).getDebugString() + "_" +
+                                 getDebugString(opAddress) + "_" +
                                  toString(w)};
 
         auto attractor = insertOp({}, {allocAddress}, attractorStr);
@@ -513,6 +1111,16 @@ private:
   // The highest change in liveness across all schedules, for each Op
   std::vector<AllocWeight> upperBoundChange;
 
+  // Set the lowest and highest change in liveness of each Op, across all
+  // schedules which satisfy the constraints of closure
+  void setBoundChanges(const transitiveclosure::TransitiveClosure &closure,
+                       std::vector<AllocWeight> &lower,
+                       std::vector<AllocWeight> &upper) const;
+
+  AllocWeight getSumLivenessLowerBound(
+      const transitiveclosure::TransitiveClosure &closure,
+      const std::vector<AllocWeight> &lowerChanges) const;
+
   void initializeTransitiveClosure();
 
   // Incrementally update the TransitiveClosure of this Graph. Note that the
@@ -534,6 +1142,38 @@ private:
   void insertStartAttractorsAssert0(uint64_t, uint64_t) const;
 };
 
+// The options of Graph::minSumLivenessAnneal, where all but the last two
+// are described there
+struct AnnealOptions {
+  MinSumLivenessAlgo algo         = MinSumLivenessAlgo::RIPPLE;
+  bool debug                      = Graph::defaultDebug();
+  uint32_t seed                   = Graph::defaultMinSumLivenessSeed();
+  bool filterSusceptible          = Graph::defaultFilterSusceptible();
+  double timeLimitSeconds         = Graph::defaultTimeLimitSeconds();
+  int64_t swapLimitCount          = Graph::defaultSwapLimitCount();
+  uint32_t nThreads               = Graph::defaultNThreads();
+  double initialTemperature       = Graph::defaultInitialTemperature();
+  CoolingSchedule coolingSchedule = Graph::defaultCoolingSchedule();
+  uint32_t nTemperatureSteps      = Graph::defaultNTemperatureSteps();
+  double coolingRate              = Graph::defaultCoolingRate();
+  LivenessObjective objective     = Graph::defaultLivenessObjective();
+  double maxWeight                = Graph::defaultMaxWeight();
+  uint64_t nTabuIterations        = Graph::defaultNTabuIterations();
+  uint32_t tabuTenure             = Graph::defaultTabuTenure();
+  double targetGapPercent         = Graph::defaultTargetGapPercent();
+  uint64_t windowSize             = Graph::defaultWindowSize();
+
+  // If set, called on the calling thread at the end of every round of the
+  // T=0 search, including a round ended by cancellation
+  std::function<void(const AnnealProgress &)> progressCallback;
+
+  // If not null, annealing stops soon after *cancel becomes true. It is
+  // checked before searching for the shifts of every Op. A shift is either
+  // applied completely or not at all, and so the Graph is always left with
+  // a valid schedule, and valid liveness
+  const std::atomic<bool> *cancel = nullptr;
+};
+
 std::ostream &operator<<(std::ostream &ost, const Graph &x);
 
 std::ostream &operator<<(std::ostream &ost, const ShiftAndCost &x);
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_SCHEDULE_ANNEAL_OFFSETPLAN_HPP
+#define POPRITHMS_SCHEDULE_ANNEAL_OFFSETPLAN_HPP
+
+#include <vector>
+
+#include <poprithms/schedule/anneal/graph.hpp>
+
+namespace poprithms {
+namespace schedule {
+namespace anneal {
+
+// Offsets of the Allocs of a scheduled Graph in memory, such that Allocs
+// which are live at the same schedule index do not overlap. An Alloc is
+// live from the first to the final schedule index of its Ops, and occupies
+// [offset, offset + weight) in the memory resource it is in.
+struct OffsetPlan {
+  // The offset of each Alloc, in its resource. Allocs without Ops are at 0.
+  std::vector<double> offsets;
+
+  // For each resource, the highest end of an Alloc in it. This is at least
+  // the max liveness of the resource, Graph::getMaxLiveness(ResourceClass).
+  std::vector<double> peaks;
+};
+
+// Plan the offsets of the Allocs of g, which must be initialized, and have
+// non-negative scalar Alloc weights.
+//
+// The Allocs of each resource are placed one at a time, in decreasing order
+// of weight times the number of schedule indices at which they are live.
+// Each is placed in the smallest gap between the Allocs already placed
+// which are live at the same time as it, that it fits in (best fit). If it
+// fits in no gap, it is placed above them all. If placing them in order of
+// the schedule index at which they become live gives a lower peak, that
+// order is used instead.
+//
+// nLocalSearchIterations : the number of iterations of a local search on
+// the placement order, which follows. In each iteration, an Alloc which
+// ends at the peak is moved to a random earlier position in the order, and
+// the Allocs from that position on are placed again. The move is kept if
+// the peak does not increase. The search stops early if the peak is the
+// max liveness, as no placement has a lower peak.
+//
+// seed : the random seed of the local search
+OffsetPlan getOffsetPlan(const Graph &g,
+                         uint64_t nLocalSearchIterations = 200,
+                         uint32_t seed                   = 1011);
+
+} // namespace anneal
+} // namespace schedule
+} // namespace poprithms
+
+#endif
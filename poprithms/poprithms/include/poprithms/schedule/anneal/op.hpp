@@ -2,6 +2,7 @@
 #ifndef POPRITHMS_SCHEDULE_ANNEAL_OP_HPP
 #define POPRITHMS_SCHEDULE_ANNEAL_OP_HPP
 
+#include <algorithm>
 #include <limits>
 #include <sstream>
 #include <vector>
@@ -15,24 +16,31 @@ namespace anneal {
 class Op {
 
 public:
-  Op(OpAddress _address_, const std::string &_debugString_);
-
-  void insertOut(OpAddress out) { outs.push_back(out); }
-  void insertIn(OpAddress i) { ins.push_back(i); }
-  void insertAlloc(AllocAddress aa) { allocs.push_back(aa); }
+  // The debug string of an Op is stored in the Graph which contains it, see
+  // Graph::getDebugString
+  Op(OpAddress _address_, DebugStringId _debugStringId_);
+
+  // An Op with all of its ins, outs and allocs, which should be sorted and
+  // unique
+  Op(OpAddress _address_,
+     std::vector<OpAddress> _ins_,
+     std::vector<OpAddress> _outs_,
+     std::vector<AllocAddress> _allocs_,
+     DebugStringId _debugStringId_);
+
+  void insertOut(OpAddress out) { pushBack(outs, out); }
+  void insertIn(OpAddress i) { pushBack(ins, i); }
+  void insertAlloc(AllocAddress aa) { pushBack(allocs, aa); }
 
   const std::vector<OpAddress> &getIns() const { return ins; }
   OpAddress getIn(uint64_t i) const { return ins[i]; }
   uint64_t nIns() const { return getIns().size(); }
   int nIns_i32() const { return static_cast<int>(nIns()); }
 
-  bool hasIn(OpAddress a) const {
-    return std::find(ins.cbegin(), ins.cend(), a) != ins.cend();
-  }
-
-  bool hasOut(OpAddress a) const {
-    return std::find(outs.cbegin(), outs.cend(), a) != outs.cend();
-  }
+  // These membership tests are O(log n) if the Op is sorted, and O(n)
+  // otherwise
+  bool hasIn(OpAddress a) const { return contains(ins, a); }
+  bool hasOut(OpAddress a) const { return contains(outs, a); }
 
   const std::vector<OpAddress> &getOuts() const { return outs; }
   OpAddress getOut(uint64_t i) const { return outs[i]; }
@@ -42,17 +50,19 @@ public:
   const std::vector<AllocAddress> &getAllocs() const { return allocs; }
   AllocAddress getAlloc(uint64_t i) const { return allocs[i]; }
   uint64_t nAllocs() const { return getAllocs().size(); }
-  bool hasAlloc(AllocAddress a) const {
-    return std::find(allocs.cbegin(), allocs.cend(), a) != allocs.cend();
-  }
+  bool hasAlloc(AllocAddress a) const { return contains(allocs, a); }
 
   OpAddress getAddress() const { return address; }
   void append(std::ostream &ost) const;
 
-  const std::string &getDebugString() const { return debugString; }
+  DebugStringId getDebugStringId() const { return debugStringId; }
 
   void sortAndMakeUnique();
 
+  // true if ins, outs and allocs are all in ascending order. This is the
+  // case after sortAndMakeUnique, until an element is inserted out of order
+  bool isSorted() const { return sorted; }
+
   bool hasForwardLink() const { return fwdLink != NoLinkVal; }
   bool hasBackwardLink() const { return bwdLink != NoLinkVal; }
   bool hasLink() const { return hasForwardLink() || hasBackwardLink(); }
@@ -62,31 +72,54 @@ public:
 
   bool operator==(const Op &rhs) const {
     return address == rhs.address && ins == rhs.ins && outs == rhs.outs &&
-           allocs == rhs.allocs && debugString == rhs.debugString;
+           allocs == rhs.allocs && debugStringId == rhs.debugStringId;
   }
   bool operator!=(const Op &rhs) const { return !operator==(rhs); }
 
   void insertForwardLink(OpAddress after) { fwdLink = after; }
   void insertBackwardLink(OpAddress before) { bwdLink = before; }
 
+  // remove all occurrences of i from the ins of this Op
   void removeIn(OpAddress i) {
-    ins.erase(std::find(ins.cbegin(), ins.cend(), i));
+    ins.erase(std::remove(ins.begin(), ins.end(), i), ins.end());
   }
 
+  // remove all occurrences of out from the outs of this Op
   void removeOut(OpAddress out) {
-    outs.erase(std::find(outs.cbegin(), outs.cend(), out));
+    outs.erase(std::remove(outs.begin(), outs.end(), out), outs.end());
   }
 
-  void appendSerialization(std::ostream &) const;
+  void removeAlloc(AllocAddress aa) {
+    allocs.erase(std::remove(allocs.begin(), allocs.end(), aa), allocs.end());
+  }
+
+  void removeForwardLink() { fwdLink = NoLinkVal; }
+  void removeBackwardLink() { bwdLink = NoLinkVal; }
+
+  void appendSerialization(std::ostream &,
+                           const std::string &debugString) const;
 
 private:
   const OpAddress address;
   std::vector<OpAddress> ins;
   std::vector<OpAddress> outs;
   std::vector<AllocAddress> allocs;
-  const std::string debugString;
+  DebugStringId debugStringId;
   OpAddress fwdLink{NoLinkVal};
   OpAddress bwdLink{NoLinkVal};
+  bool sorted{true};
+
+  template <typename T> void pushBack(std::vector<T> &v, T x) {
+    sorted = sorted && (v.empty() || !(x < v.back()));
+    v.push_back(x);
+  }
+
+  template <typename T> bool contains(const std::vector<T> &v, T x) const {
+    if (sorted) {
+      return std::binary_search(v.cbegin(), v.cend(), x);
+    }
+    return std::find(v.cbegin(), v.cend(), x) != v.cend();
+  }
 
 public:
   static const OpAddress NoLinkVal = std::numeric_limits<OpAddress>::max();
@@ -9,17 +9,23 @@ namespace poprithms {
 namespace schedule {
 namespace anneal {
 
-class TrackEntry {
+// W is the type used to accumulate Alloc weights in the ripple algorithm.
+// This is either AllocWeight, or double when all Allocs have non-zero weight
+// only in the centre lexicographic position.
+template <typename W> class TrackEntry {
 public:
-  TrackEntry(ScheduleIndex, AllocWeight, AllocWeight, bool);
+  TrackEntry(ScheduleIndex t, W w, W i, bool l)
+      : entryTime(t), entryWeight(w), incrWeight(i), live(l) {}
 
   ScheduleIndex entryTime; // when registered
-  AllocWeight entryWeight; // cost when registered
-  AllocWeight
-      incrWeight; // amount to increment cumulative cost at each iteration
+  W entryWeight;           // cost when registered
+  W incrWeight; // amount to increment cumulative cost at each iteration
   bool live;
 };
 
+extern template class TrackEntry<AllocWeight>;
+extern template class TrackEntry<double>;
+
 } // namespace anneal
 } // namespace schedule
 } // namespace poprithms
@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_COMPRESSEDROWS_HPP
+#define POPRITHMS_UTIL_COMPRESSEDROWS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <poprithms/util/span.hpp>
+
+namespace poprithms {
+namespace util {
+
+// A sequence of variable length rows, stored in compressed sparse row (CSR)
+// format: the elements of all rows are stored contiguously in a single
+// vector, and row r is the range [offsets[r], offsets[r+1]) of it. Compared
+// to a std::vector<std::vector<T>>, this has 2 heap allocations in total
+// instead of 1 per row, and copying is 2 contiguous copies.
+//
+// Rows are appended with appendRow. Thereafter, elements can be modified in
+// place, and contiguous ranges of rows can be rotated, but the lengths of
+// rows cannot be changed individually.
+template <typename T> class CompressedRows {
+
+public:
+  CompressedRows() : offsets(1, 0) {}
+
+  uint64_t nRows() const { return offsets.size() - 1; }
+  uint64_t nElements() const { return values.size(); }
+
+  void clear() {
+    offsets.assign(1, 0);
+    values.clear();
+  }
+
+  void reserve(uint64_t nRows_, uint64_t nElements_) {
+    offsets.reserve(nRows_ + 1);
+    values.reserve(nElements_);
+  }
+
+  template <typename Iter> void appendRow(Iter begin, Iter end) {
+    values.insert(values.end(), begin, end);
+    offsets.push_back(values.size());
+  }
+
+  // append a row of n default constructed Ts
+  void appendRow(uint64_t n) {
+    values.resize(values.size() + n);
+    offsets.push_back(values.size());
+  }
+
+  uint64_t rowSize(uint64_t r) const { return offsets[r + 1] - offsets[r]; }
+
+  Span<const T> operator[](uint64_t r) const {
+    return {values.data() + offsets[r], rowSize(r)};
+  }
+
+  Span<T> row(uint64_t r) { return {values.data() + offsets[r], rowSize(r)}; }
+
+  // Move the rows in [r1, r2) to directly before row r0, where
+  // r0 <= r1 <= r2. This is the row-wise equivalent of std::rotate, and
+  // runs in time linear in the number of elements and rows in [r0, r2).
+  void rotateRows(uint64_t r0, uint64_t r1, uint64_t r2) {
+    std::rotate(std::next(values.begin(), offsets[r0]),
+                std::next(values.begin(), offsets[r1]),
+                std::next(values.begin(), offsets[r2]));
+
+    // convert offsets[r0+1, r2+1) to row sizes in place, rotate them, and
+    // then convert them back to offsets.
+    for (uint64_t r = r2; r > r0; --r) {
+      offsets[r] -= offsets[r - 1];
+    }
+    std::rotate(std::next(offsets.begin(), r0 + 1),
+                std::next(offsets.begin(), r1 + 1),
+                std::next(offsets.begin(), r2 + 1));
+    for (uint64_t r = r0 + 1; r <= r2; ++r) {
+      offsets[r] += offsets[r - 1];
+    }
+  }
+
+  bool operator==(const CompressedRows &rhs) const {
+    return offsets == rhs.offsets && values == rhs.values;
+  }
+  bool operator!=(const CompressedRows &rhs) const {
+    return !operator==(rhs);
+  }
+
+private:
+  // offsets[r] is the index in values of the first element of row r. There
+  // are nRows() + 1 offsets, the final one being values.size().
+  std::vector<uint64_t> offsets;
+  std::vector<T> values;
+};
+
+} // namespace util
+} // namespace poprithms
+
+#endif
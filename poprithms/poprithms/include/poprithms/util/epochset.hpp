@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_EPOCHSET_HPP
+#define POPRITHMS_UTIL_EPOCHSET_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace poprithms {
+namespace util {
+
+// A set of ids in [0, n), which lists its ids in the order they were
+// inserted. An id is in the set if its stamp is the current epoch, so
+// clearing the set is O(size()) rather than O(n). Memory for all n ids is
+// reserved up front, so a set which is cleared and reused never allocates.
+class EpochSet {
+
+public:
+  EpochSet() = default;
+  explicit EpochSet(uint64_t n) { setUniverseSize(n); }
+
+  // Copies reserve memory for all ids too, which std::vector does not
+  EpochSet(const EpochSet &rhs)
+      : stamps(rhs.stamps), epoch(rhs.epoch), ids(rhs.ids) {
+    ids.reserve(stamps.size());
+  }
+  EpochSet &operator=(const EpochSet &rhs) {
+    stamps = rhs.stamps;
+    epoch  = rhs.epoch;
+    ids    = rhs.ids;
+    ids.reserve(stamps.size());
+    return *this;
+  }
+  EpochSet(EpochSet &&)            = default;
+  EpochSet &operator=(EpochSet &&) = default;
+
+  // The number of ids which can be inserted
+  uint64_t universeSize() const { return stamps.size(); }
+
+  // Change the number of ids which can be inserted, emptying the set
+  void setUniverseSize(uint64_t n) {
+    stamps.assign(n, 0);
+    epoch = 1;
+    ids.clear();
+    ids.reserve(n);
+  }
+
+  // Insert id, returning false if it was already in the set
+  bool insert(uint64_t id) {
+    if (stamps[id] == epoch) {
+      return false;
+    }
+    stamps[id] = epoch;
+    ids.push_back(id);
+    return true;
+  }
+
+  bool contains(uint64_t id) const { return stamps[id] == epoch; }
+
+  void clear() {
+    ++epoch;
+    ids.clear();
+  }
+
+  uint64_t size() const { return ids.size(); }
+  bool empty() const { return ids.empty(); }
+  const std::vector<uint64_t> &get() const { return ids; }
+  std::vector<uint64_t>::const_iterator begin() const { return ids.cbegin(); }
+  std::vector<uint64_t>::const_iterator end() const { return ids.cend(); }
+
+private:
+  // stamps[id] == epoch if and only if id is in the set
+  std::vector<uint64_t> stamps;
+  uint64_t epoch{1};
+  std::vector<uint64_t> ids;
+};
+
+} // namespace util
+} // namespace poprithms
+
+#endif
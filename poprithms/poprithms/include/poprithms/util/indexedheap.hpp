@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_INDEXEDHEAP_HPP
+#define POPRITHMS_UTIL_INDEXEDHEAP_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace poprithms {
+namespace util {
+
+// A binary min-heap of ids in [0, nIds), each with a Key. In addition to
+// push and pop, the Key of an id in the heap can be changed in O(log n),
+// which std::priority_queue does not support. Key must support operator<,
+// and need not be default constructible.
+template <typename Key> class IndexedHeap {
+
+public:
+  explicit IndexedHeap(uint64_t nIds)
+      : positions(nIds, notInHeap) {}
+
+  bool empty() const { return heap.empty(); }
+  uint64_t size() const { return heap.size(); }
+  bool contains(uint64_t id) const { return positions[id] != notInHeap; }
+
+  // The id with the lowest Key, the heap must not be empty
+  uint64_t top() const { return heap[0].second; }
+
+  // The Key of id, which must be in the heap
+  const Key &key(uint64_t id) const { return heap[positions[id]].first; }
+
+  // id must not already be in the heap
+  void push(uint64_t id, const Key &k) {
+    positions[id] = heap.size();
+    heap.push_back({k, id});
+    siftUp(heap.size() - 1);
+  }
+
+  // Remove and return the id with the lowest Key
+  uint64_t pop() {
+    const auto id = heap[0].second;
+    swapNodes(0, heap.size() - 1);
+    heap.pop_back();
+    positions[id] = notInHeap;
+    if (!heap.empty()) {
+      siftDown(0);
+    }
+    return id;
+  }
+
+  // Change the Key of id, which must be in the heap
+  void update(uint64_t id, const Key &k) {
+    const auto position  = positions[id];
+    const bool decreased = k < heap[position].first;
+    heap[position].first = k;
+    if (decreased) {
+      siftUp(position);
+    } else {
+      siftDown(position);
+    }
+  }
+
+  // Remove id, which must be in the heap
+  void remove(uint64_t id) {
+    const auto position = positions[id];
+    swapNodes(position, heap.size() - 1);
+    heap.pop_back();
+    positions[id] = notInHeap;
+    if (position < heap.size()) {
+      siftUp(position);
+      siftDown(position);
+    }
+  }
+
+private:
+  static constexpr uint64_t notInHeap = std::numeric_limits<uint64_t>::max();
+
+  // positions[id] is the index of id in heap, or notInHeap
+  std::vector<uint64_t> positions;
+  std::vector<std::pair<Key, uint64_t>> heap;
+
+  bool lower(uint64_t i, uint64_t j) const {
+    return heap[i].first < heap[j].first;
+  }
+
+  void swapNodes(uint64_t i, uint64_t j) {
+    std::swap(heap[i], heap[j]);
+    positions[heap[i].second] = i;
+    positions[heap[j].second] = j;
+  }
+
+  void siftUp(uint64_t i) {
+    while (i > 0 && lower(i, (i - 1) / 2)) {
+      swapNodes(i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
+  }
+
+  void siftDown(uint64_t i) {
+    while (true) {
+      auto smallest = i;
+      for (auto child : {2 * i + 1, 2 * i + 2}) {
+        if (child < heap.size() && lower(child, smallest)) {
+          smallest = child;
+        }
+      }
+      if (smallest == i) {
+        return;
+      }
+      swapNodes(i, smallest);
+      i = smallest;
+    }
+  }
+};
+
+template <typename Key> constexpr uint64_t IndexedHeap<Key>::notInHeap;
+
+} // namespace util
+} // namespace poprithms
+
+#endif
@@ -0,0 +1,122 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_SEGMENTTREE_HPP
+#define POPRITHMS_UTIL_SEGMENTTREE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace poprithms {
+namespace util {
+
+// A segment tree over a sequence of values, supporting the addition of a
+// value to all elements in a range, and the maximum over a range, both in
+// O(log n). T must support operator+, operator+= and operator<, and T(0)
+// must be the additive identity.
+//
+// Additions are not propagated down the tree lazily. Instead, each node
+// stores the addition which applies to its entire range, and so rangeMax
+// does not modify the tree, and can be called concurrently.
+template <typename T> class SegmentTree {
+
+public:
+  SegmentTree() = default;
+
+  explicit SegmentTree(const std::vector<T> &initial)
+      : n(initial.size()), maxes(4 * initial.size(), T(0)),
+        adds(4 * initial.size(), T(0)) {
+    if (n != 0) {
+      build(1, 0, n, initial);
+    }
+  }
+
+  uint64_t size() const { return n; }
+
+  // Add delta to all elements in [begin, end)
+  void rangeAdd(uint64_t begin, uint64_t end, const T &delta) {
+    if (begin < end) {
+      add(1, 0, n, begin, end, delta);
+    }
+  }
+
+  // The maximum element in [begin, end), which must not be empty
+  T rangeMax(uint64_t begin, uint64_t end) const {
+    return query(1, 0, n, begin, end);
+  }
+
+  // The maximum element, the tree must not be empty
+  T max() const { return maxes[1]; }
+
+  // The element at index i
+  T at(uint64_t i) const { return rangeMax(i, i + 1); }
+
+private:
+  uint64_t n{0};
+
+  // maxes[node] is the maximum of the node's range, including the additions
+  // made at the node and at all of its descendants
+  std::vector<T> maxes;
+
+  // additions which apply to all elements of the node's range
+  std::vector<T> adds;
+
+  void build(uint64_t node,
+             uint64_t lo,
+             uint64_t hi,
+             const std::vector<T> &initial) {
+    if (hi - lo == 1) {
+      maxes[node] = initial[lo];
+      return;
+    }
+    const auto mid = lo + (hi - lo) / 2;
+    build(2 * node, lo, mid, initial);
+    build(2 * node + 1, mid, hi, initial);
+    maxes[node] = std::max(maxes[2 * node], maxes[2 * node + 1]);
+  }
+
+  void add(uint64_t node,
+           uint64_t lo,
+           uint64_t hi,
+           uint64_t begin,
+           uint64_t end,
+           const T &delta) {
+    if (begin <= lo && hi <= end) {
+      maxes[node] += delta;
+      adds[node] += delta;
+      return;
+    }
+    const auto mid = lo + (hi - lo) / 2;
+    if (begin < mid) {
+      add(2 * node, lo, mid, begin, end, delta);
+    }
+    if (end > mid) {
+      add(2 * node + 1, mid, hi, begin, end, delta);
+    }
+    maxes[node] =
+        adds[node] + std::max(maxes[2 * node], maxes[2 * node + 1]);
+  }
+
+  T query(uint64_t node,
+          uint64_t lo,
+          uint64_t hi,
+          uint64_t begin,
+          uint64_t end) const {
+    if (begin <= lo && hi <= end) {
+      return maxes[node];
+    }
+    const auto mid = lo + (hi - lo) / 2;
+    if (end <= mid) {
+      return adds[node] + query(2 * node, lo, mid, begin, end);
+    }
+    if (begin >= mid) {
+      return adds[node] + query(2 * node + 1, mid, hi, begin, end);
+    }
+    return adds[node] + std::max(query(2 * node, lo, mid, begin, end),
+                                 query(2 * node + 1, mid, hi, begin, end));
+  }
+};
+
+} // namespace util
+} // namespace poprithms
+
+#endif
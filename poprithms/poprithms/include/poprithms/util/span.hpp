@@ -0,0 +1,45 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_SPAN_HPP
+#define POPRITHMS_UTIL_SPAN_HPP
+
+#include <cstdint>
+
+namespace poprithms {
+namespace util {
+
+// A non-owning view of a contiguous sequence of Ts. This is a minimal
+// C++11-compatible alternative to std::span (which is only introduced in
+// C++20). A Span is invalidated by any operation which invalidates pointers
+// into the underlying storage.
+template <typename T> class Span {
+
+public:
+  using value_type     = T;
+  using iterator       = T *;
+  using const_iterator = const T *;
+
+  Span() = default;
+  Span(T *data, uint64_t size) : data_(data), size_(size) {}
+
+  T *data() const { return data_; }
+  uint64_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T *begin() const { return data_; }
+  T *end() const { return data_ + size_; }
+  const T *cbegin() const { return data_; }
+  const T *cend() const { return data_ + size_; }
+
+  T &operator[](uint64_t i) const { return data_[i]; }
+  T &front() const { return data_[0]; }
+  T &back() const { return data_[size_ - 1]; }
+
+private:
+  T *data_{nullptr};
+  uint64_t size_{0};
+};
+
+} // namespace util
+} // namespace poprithms
+
+#endif
@@ -0,0 +1,43 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_STRINGPOOL_HPP
+#define POPRITHMS_UTIL_STRINGPOOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace poprithms {
+namespace util {
+
+// A pool of unique strings, each identified by a 32-bit id. Each distinct
+// string is stored once, no matter how many times it is interned. The empty
+// string always has id 0, and is interned without being hashed.
+class StringPool {
+
+public:
+  StringPool();
+
+  static constexpr uint32_t EmptyId = 0;
+
+  // The id of "s", inserting it into the pool if it is not already present
+  uint32_t intern(const std::string &s);
+
+  const std::string &get(uint32_t id) const { return strings[id]; }
+
+  // The number of distinct strings in the pool, including the empty string
+  uint64_t size() const { return strings.size(); }
+
+private:
+  std::vector<std::string> strings;
+
+  // The ids of the strings with a given hash. The hashes are used as keys,
+  // rather than the strings themselves, so that each string is only stored
+  // once, and so that StringPools can be copied without fixing up pointers
+  std::unordered_multimap<uint64_t, uint32_t> idsByHash;
+};
+
+} // namespace util
+} // namespace poprithms
+
+#endif
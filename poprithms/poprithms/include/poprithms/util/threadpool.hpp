@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef POPRITHMS_UTIL_THREADPOOL_HPP
+#define POPRITHMS_UTIL_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace poprithms {
+namespace util {
+
+// A fixed set of worker threads which repeatedly execute parallel loops. The
+// calling thread participates in every loop as thread 0, and so a ThreadPool
+// with 1 thread never creates any additional threads.
+class ThreadPool {
+
+public:
+  // Task "task" is run on thread "thread", where thread is in [0, nThreads).
+  // If a Task returns false, no further tasks are started.
+  using Task = std::function<bool(uint64_t task, uint64_t thread)>;
+
+  explicit ThreadPool(uint64_t nThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint64_t nThreads() const { return workers.size() + 1; }
+
+  // Run f on all task indices in [0, nTasks). Task indices are claimed by
+  // threads in increasing order, so if task t returns false then every task
+  // index lower than t is run to completion. This method blocks until all
+  // started tasks are complete. An exception thrown by a task is rethrown on
+  // the calling thread.
+  void forEach(uint64_t nTasks, const Task &f);
+
+private:
+  void runTasks(uint64_t thread);
+  void workerLoop(uint64_t thread);
+
+  std::vector<std::thread> workers;
+
+  std::mutex mut;
+  std::condition_variable startCondition;
+  std::condition_variable doneCondition;
+
+  // incremented every time forEach is called, signals workers to start
+  uint64_t generation{0};
+  uint64_t nWorkersActive{0};
+  bool terminate{false};
+
+  const Task *currentTask{nullptr};
+  uint64_t currentNTasks{0};
+  std::atomic<uint64_t> nextTask{0};
+  std::exception_ptr firstException;
+};
+
+} // namespace util
+} // namespace poprithms
+
+#endif
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <sstream>
 
@@ -169,6 +170,10 @@ private:
 
 } implContainer;
 
+// Loggers may be used concurrently, for example by the annealing algorithms
+// which run on multiple threads. Writes are serialized with this mutex.
+std::mutex logMutex;
+
 } // namespace
 
 LoggerImpl::LoggerImpl(const std::string &_id_, LoggerImplContainer *c)
@@ -200,18 +205,21 @@ std::string LoggerImpl::prefix() {
 
 void Logger::info(const std::string &x) const {
   if (shouldLog(Level::Info)) {
+    std::lock_guard<std::mutex> lock(logMutex);
     std::cout << impl->prefix() << " [info]  " << x << std::endl;
   }
 }
 
 void Logger::debug(const std::string &x) const {
   if (shouldLog(Level::Debug)) {
+    std::lock_guard<std::mutex> lock(logMutex);
     std::cout << impl->prefix() << " [debug] " << x << std::endl;
   }
 }
 
 void Logger::trace(const std::string &x) const {
   if (shouldLog(Level::Trace)) {
+    std::lock_guard<std::mutex> lock(logMutex);
     std::cout << impl->prefix() << " [trace] " << x << std::endl;
   }
 }
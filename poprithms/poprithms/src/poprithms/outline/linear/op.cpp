@@ -1,5 +1,6 @@
 // Copyright (c) 2020 Graphcore Ltd. All rights reserved.
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 #include <poprithms/outline/linear/error.hpp>
@@ -15,13 +15,16 @@ void Alloc::sortAndMakeUnique() { ops = util::unisorted(ops); }
 void Alloc::appendSerialization(std::ostream &ost) const {
   ost << "{\"address\":" << address << ",\"weight\":";
   weight.appendSerialization(ost);
-  ost << '}';
+  ost << ",\"resource\":" << resource << '}';
 }
 
 std::ostream &operator<<(std::ostream &ost, const Alloc &alloc) {
   ost << alloc.getAddress() << " ops=";
   util::append(ost, alloc.getOps());
   ost << " weight=" << alloc.getWeight();
+  if (alloc.getResourceClass() != 0) {
+    ost << " resource=" << alloc.getResourceClass();
+  }
   return ost;
 }
 
@@ -42,7 +42,7 @@ private:
 };
 
 AllocWeight::AllocWeight(double _v_, int relativeLexico)
-    : v{0, 0, 0, 0, 0, 0, 0} {
+    : v{0, 0, 0, 0, 0, 0, 0, 0} {
   //   -3 -2  -1 0  1  2  3
   if (std::abs(relativeLexico) >= (NAW + 1) / 1) {
     throw error("invalid relativeLexico in AllocWeight constructor");
@@ -1,17 +1,25 @@
 // Copyright (c) 2020 Graphcore Ltd. All rights reserved.
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <iterator>
 #include <limits>
+#include <queue>
 #include <random>
+#include <tuple>
 
 #include <poprithms/schedule/anneal/error.hpp>
 #include <poprithms/schedule/anneal/filteredschedule.hpp>
 #include <poprithms/schedule/anneal/graph.hpp>
 #include <poprithms/schedule/anneal/graphserialization.hpp>
 #include <poprithms/schedule/anneal/logging.hpp>
+#include <poprithms/util/indexedheap.hpp>
 #include <poprithms/util/printiter.hpp>
 #include <poprithms/util/stringutil.hpp>
+#include <poprithms/util/threadpool.hpp>
 #include <poprithms/util/unisort.hpp>
 
 namespace poprithms {
@@ -45,11 +53,48 @@ custom_lower_bound(ForwardIt first, ForwardIt last, const T &value) {
 
 namespace {
 constexpr const char *const spaces = "         ";
+
+AllocWeight toAllocWeight(const AllocWeight &w) { return w; }
+AllocWeight toAllocWeight(double w) { return AllocWeight(w); }
+} // namespace
+
+template <>
+AllocWeight Graph::getRippleWeight<AllocWeight>(AllocAddress a) const {
+  return getAllocWeight(a);
+}
+
+template <> double Graph::getRippleWeight<double>(AllocAddress a) const {
+  return scalarAllocWeights[a];
+}
+
+void Graph::setScalarAllocWeights() {
+  scalarAllocWeights.clear();
+  if (std::all_of(allAllocs.cbegin(), allAllocs.cend(), [](const Alloc &a) {
+        return a.getWeight().isCentreOnly();
+      })) {
+    scalarAllocWeights.reserve(nAllocs());
+    for (AllocAddress a = 0; a < nAllocs(); ++a) {
+      scalarAllocWeights.push_back(getAllocWeight(a).getCentre());
+    }
+  }
+}
+
+void Graph::throwNotEditable(const std::string &edit) const {
+  std::ostringstream oss;
+  oss << "Cannot " << edit << ", as the anneal::Graph was initialized "
+      << "with TransitiveClosureOptimizations, whose constraints and links "
+      << "the edit could make invalid. Edit a copy of the Graph taken "
+      << "before it was initialized.";
+  throw error(oss.str());
 }
 
 OpAddress Graph::insertOp(const std::string &dbs) {
+  if (!isEditable()) {
+    throwNotEditable("insert Op " + dbs);
+  }
   OpAddress op = nOps();
-  allOps.push_back({op, dbs});
+  allOps.push_back({op, debugStrings.intern(dbs)});
+  registerEdit(op);
   return op;
 }
 
@@ -115,9 +160,164 @@ std::vector<std::vector<OpAddress>> Graph::getTightChains() const {
   return tightChains;
 }
 
+namespace {
+// Union-find, where the representative of a set is its lowest element
+class DisjointSets {
+public:
+  explicit DisjointSets(uint64_t n) : parents(n) {
+    std::iota(parents.begin(), parents.end(), 0UL);
+  }
+
+  uint64_t find(uint64_t a) {
+    while (parents[a] != a) {
+      parents[a] = parents[parents[a]];
+      a          = parents[a];
+    }
+    return a;
+  }
+
+  void unite(uint64_t a, uint64_t b) {
+    a = find(a);
+    b = find(b);
+    if (a != b) {
+      parents[std::max(a, b)] = std::min(a, b);
+    }
+  }
+
+private:
+  std::vector<uint64_t> parents;
+};
+} // namespace
+
+std::vector<std::vector<OpAddress>> Graph::getComponents() const {
+  DisjointSets sets(nOps());
+  for (const auto &op : getOps()) {
+    for (auto outAddress : op.getOuts()) {
+      sets.unite(op.getAddress(), outAddress);
+    }
+  }
+  for (const auto &alloc : getAllocs()) {
+    for (auto opAddress : alloc.getOps()) {
+      sets.unite(alloc.getOps()[0], opAddress);
+    }
+  }
+
+  // Ops are visited in increasing order, so the lowest Op of a component,
+  // which is its representative, is the first of it to be visited.
+  std::vector<std::vector<OpAddress>> components;
+  std::vector<uint64_t> componentIndex(nOps());
+  for (OpAddress a = 0; a < nOps(); ++a) {
+    const auto root = sets.find(a);
+    if (root == a) {
+      componentIndex[a] = components.size();
+      components.push_back({});
+    }
+    components[componentIndex[root]].push_back(a);
+  }
+  return components;
+}
+
+Graph Graph::getComponentGraph(
+    const std::vector<OpAddress> &component,
+    const std::vector<uint64_t> &localOps,
+    const std::vector<uint64_t> &localAllocs) const {
+  Graph g;
+  for (uint64_t i = 0; i < component.size(); ++i) {
+    g.insertOp(std::string{});
+  }
+  for (auto opAddress : component) {
+    for (auto allocAddress : getOp(opAddress).getAllocs()) {
+      if (localAllocs[allocAddress] == g.nAllocs()) {
+        g.insertAlloc(getAlloc(allocAddress).getWeight(),
+                      getAlloc(allocAddress).getResourceClass());
+      }
+      g.insertOpAlloc(localOps[opAddress], localAllocs[allocAddress]);
+    }
+  }
+  for (auto opAddress : component) {
+    for (auto outAddress : getOp(opAddress).getOuts()) {
+      g.insertConstraint(localOps[opAddress], localOps[outAddress]);
+    }
+  }
+  for (auto opAddress : component) {
+    if (getOp(opAddress).hasForwardLink()) {
+      g.insertLink(localOps[opAddress],
+                   localOps[getOp(opAddress).getForwardLink()]);
+    }
+  }
+  g.resourceWeights = resourceWeights;
+  return g;
+}
+
+std::vector<std::vector<OpAddress>> Graph::getCoarseningChains() const {
+
+  auto chains = getTightChains();
+
+  std::vector<bool> matched(nOps(), false);
+  for (const auto &chain : chains) {
+    for (auto opAddress : chain) {
+      matched[opAddress] = true;
+    }
+  }
+
+  // The total weight of the Allocs of both a and b. Allocs are sorted, as
+  // the Graph is finalized.
+  auto getSharedWeight = [this](OpAddress a, OpAddress b) {
+    const auto &allocs0 = getOp(a).getAllocs();
+    const auto &allocs1 = getOp(b).getAllocs();
+    AllocWeight shared{0};
+    auto iter1 = allocs1.cbegin();
+    for (auto allocAddress : allocs0) {
+      iter1 = std::lower_bound(iter1, allocs1.cend(), allocAddress);
+      if (iter1 != allocs1.cend() && *iter1 == allocAddress) {
+        shared += getAllocWeight(allocAddress);
+      }
+    }
+    return shared;
+  };
+
+  constexpr OpAddress None{std::numeric_limits<OpAddress>::max()};
+  for (OpAddress a = 0; a < nOps(); ++a) {
+    if (matched[a]) {
+      continue;
+    }
+    const auto &op = getOp(a);
+    OpAddress best{None};
+    AllocWeight bestWeight{0};
+    for (auto b : op.getOuts()) {
+      if (matched[b] || (op.nOuts() != 1 && getOp(b).nIns() != 1)) {
+        continue;
+      }
+      const auto w = getSharedWeight(a, b);
+      if (best == None || bestWeight < w) {
+        best       = b;
+        bestWeight = w;
+      }
+    }
+    if (best != None) {
+      chains.push_back({a, best});
+      matched[a]    = true;
+      matched[best] = true;
+    }
+  }
+
+  return chains;
+}
+
 void Graph::insertOpAlloc(OpAddress oa, AllocAddress aa) {
+  if (!isEditable()) {
+    throwNotEditable("insert Alloc " + std::to_string(aa) + " into Op " +
+                     std::to_string(oa));
+  }
   allAllocs[aa].insertOp(oa);
   allOps[oa].insertAlloc(aa);
+  if (isInitialized) {
+    // the liveness of the Alloc, and so the cost of shifting any of its Ops,
+    // may change
+    for (auto opAddress : getAlloc(aa).getOps()) {
+      registerEdit(opAddress);
+    }
+  }
 }
 
 void Graph::insertOpAlloc(const std::vector<OpAddress> &oas,
@@ -153,27 +353,117 @@ void Graph::insertAttractions(
 }
 
 void Graph::removeConstraint(OpAddress before, OpAddress after) {
+  if (!isEditable()) {
+    throwNotEditable("remove constraint " + std::to_string(before) + " -> " +
+                     std::to_string(after));
+  }
+  if (before >= nOps() || after >= nOps() || !getOp(before).hasOut(after)) {
+    std::ostringstream oss;
+    oss << "Cannot remove constraint " << before << " -> " << after
+        << ", as it is not in the anneal::Graph";
+    throw error(oss.str());
+  }
+  if (getOp(before).getForwardLink() == after) {
+    std::ostringstream oss;
+    oss << "Cannot remove constraint " << before << " -> " << after
+        << ", as it is a link. Links can be removed with removeOp.";
+    throw error(oss.str());
+  }
   allOps[before].removeOut(after);
   allOps[after].removeIn(before);
+  registerEdit(before);
+  registerEdit(after);
+}
+
+void Graph::removeOp(OpAddress a) {
+  if (!isEditable()) {
+    throwNotEditable("remove Op " + std::to_string(a));
+  }
+  if (a >= nOps()) {
+    std::ostringstream oss;
+    oss << "Cannot remove Op " << a << ", as there are only " << nOps()
+        << " Ops in the anneal::Graph";
+    throw error(oss.str());
+  }
+
+  registerEdit(a);
+
+  // links
+  if (getOp(a).hasForwardLink()) {
+    const auto after = getOp(a).getForwardLink();
+    allOps[a].removeForwardLink();
+    allOps[after].removeBackwardLink();
+    opsWithFwdLinks.erase(
+        std::find(opsWithFwdLinks.cbegin(), opsWithFwdLinks.cend(), a));
+  }
+  if (getOp(a).hasBackwardLink()) {
+    const auto before = getOp(a).getBackwardLink();
+    allOps[before].removeForwardLink();
+    allOps[a].removeBackwardLink();
+    opsWithFwdLinks.erase(std::find(
+        opsWithFwdLinks.cbegin(), opsWithFwdLinks.cend(), before));
+  }
+
+  // constraints
+  const auto ins = getOp(a).getIns();
+  for (auto inAddress : ins) {
+    removeConstraint(inAddress, a);
+  }
+  const auto outs = getOp(a).getOuts();
+  for (auto outAddress : outs) {
+    removeConstraint(a, outAddress);
+  }
+
+  // allocs
+  const auto allocs = getOp(a).getAllocs();
+  for (auto allocAddress : allocs) {
+    allAllocs[allocAddress].removeOp(a);
+    allOps[a].removeAlloc(allocAddress);
+    for (auto opAddress : getAlloc(allocAddress).getOps()) {
+      registerEdit(opAddress);
+    }
+  }
+}
+
+void Graph::removeAlloc(AllocAddress aa) {
+  if (!isEditable()) {
+    throwNotEditable("remove Alloc " + std::to_string(aa));
+  }
+  if (aa >= nAllocs()) {
+    std::ostringstream oss;
+    oss << "Cannot remove Alloc " << aa << ", as there are only "
+        << nAllocs() << " Allocs in the anneal::Graph";
+    throw error(oss.str());
+  }
+  const auto ops = getAlloc(aa).getOps();
+  for (auto opAddress : ops) {
+    allOps[opAddress].removeAlloc(aa);
+    allAllocs[aa].removeOp(opAddress);
+    registerEdit(opAddress);
+  }
 }
 
 void Graph::insertConstraint(OpAddress before, OpAddress after) {
+  if (!isEditable()) {
+    throwNotEditable("insert constraint " + std::to_string(before) + " -> " +
+                     std::to_string(after));
+  }
   if (before >= nOps() || after >= nOps()) {
     std::ostringstream oss;
     oss << "Cannot insert constraint " << before << " -> " << after
         << ", as there are only " << nOps() << " Ops in the anneal::Graph";
     throw error(oss.str());
   }
-  if (!allOps[before].hasOut(after)) {
+  if (deferringDeduplication || !allOps[before].hasOut(after)) {
     allOps[before].insertOut(after);
     allOps[after].insertIn(before);
+    registerEdit(before);
+    registerEdit(after);
   }
 }
 
 void Graph::insertLink(OpAddress before, OpAddress after) {
-  if (!getOp(before).hasOut(after)) {
-    insertConstraint(before, after);
-  }
+  insertConstraint(before, after);
 
   const auto &op0 = getOp(before);
   const auto &op1 = getOp(after);
@@ -181,8 +471,9 @@ void Graph::insertLink(OpAddress before, OpAddress after) {
   if (op0.hasForwardLink() && op0.getForwardLink() != after) {
     std::ostringstream oss;
     oss << "Ops can have at most one link forward. "
-        << "Op " << op0 << " already has " << getOp(op0.getForwardLink())
-        << " as a forward link, and so " << op1
+        << "Op " << getDebugString(before) << " already has "
+        << getDebugString(op0.getForwardLink())
+        << " as a forward link, and so " << getDebugString(after)
         << " cannot be added as a forward link.";
     throw error(oss.str());
   }
@@ -190,8 +481,9 @@ void Graph::insertLink(OpAddress before, OpAddress after) {
   if (op1.hasBackwardLink() && op1.getBackwardLink() != before) {
     std::ostringstream oss;
     oss << "Ops can have at most one link backward. "
-        << "Op " << op1 << " already has " << getOp(op1.getBackwardLink())
-        << " as a backward link, and so " << op0
+        << "Op " << getDebugString(after) << " already has "
+        << getDebugString(op1.getBackwardLink())
+        << " as a backward link, and so " << getDebugString(before)
         << " cannot be added as a backward link.";
     throw error(oss.str());
   }
@@ -201,6 +493,8 @@ void Graph::insertLink(OpAddress before, OpAddress after) {
   }
   allOps[before].insertForwardLink(after);
   allOps[after].insertBackwardLink(before);
+  registerEdit(before);
+  registerEdit(after);
 }
 
 void Graph::insertConstraints(
@@ -210,30 +504,199 @@ void Graph::insertConstraints(
   }
 }
 
+void Graph::deferDeduplication() {
+  if (isInitialized) {
+    throw error("deferDeduplication cannot be called once the Graph is "
+                "initialized");
+  }
+  deferringDeduplication = true;
+}
+
+bool Graph::operator==(const Graph &rhs) const {
+  if (nOps() != rhs.nOps() || allAllocs != rhs.allAllocs) {
+    return false;
+  }
+  for (ResourceClass r = 0;
+       r < std::max(resourceWeights.size(), rhs.resourceWeights.size());
+       ++r) {
+    if (getResourceWeight(r) != rhs.getResourceWeight(r)) {
+      return false;
+    }
+  }
+  for (OpAddress a = 0; a < nOps(); ++a) {
+    const auto &op0 = getOp(a);
+    const auto &op1 = rhs.getOp(a);
+    if (op0.getIns() != op1.getIns() || op0.getOuts() != op1.getOuts() ||
+        op0.getAllocs() != op1.getAllocs() ||
+        getDebugString(a) != rhs.getDebugString(a)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Graph::reserve(uint64_t nOps_, uint64_t nAllocs_) {
+  allOps.reserve(nOps_);
+  allAllocs.reserve(nAllocs_);
+}
+
+namespace {
+void assertValidCompressedRows(const std::vector<uint64_t> &offsets,
+                               uint64_t nRows,
+                               uint64_t nTargets,
+                               const std::string &name) {
+  if (offsets.size() != nRows + 1) {
+    std::ostringstream oss;
+    oss << "Expected " << nRows + 1 << " " << name << " offsets, not "
+        << offsets.size() << '.';
+    throw error(oss.str());
+  }
+  if (offsets[0] != 0 || offsets.back() != nTargets) {
+    std::ostringstream oss;
+    oss << "The " << name << " offsets should start at 0 and end at "
+        << nTargets << ", the number of " << name
+        << " targets. They are from " << offsets[0] << " to "
+        << offsets.back() << '.';
+    throw error(oss.str());
+  }
+  for (uint64_t i = 0; i < nRows; ++i) {
+    if (offsets[i + 1] < offsets[i]) {
+      std::ostringstream oss;
+      oss << "The " << name << " offsets should be non-decreasing, but "
+          << "offset " << i + 1 << " is less than offset " << i << '.';
+      throw error(oss.str());
+    }
+  }
+}
+
+// The sorted, unique elements of row r of a CSR array, all of which must be
+// less than "upper"
+template <typename T>
+std::vector<T> getCompressedRow(const std::vector<uint64_t> &offsets,
+                                const std::vector<T> &targets,
+                                uint64_t r,
+                                uint64_t upper,
+                                const std::string &name) {
+  std::vector<T> row(std::next(targets.cbegin(), offsets[r]),
+                     std::next(targets.cbegin(), offsets[r + 1]));
+  std::sort(row.begin(), row.end());
+  row.erase(std::unique(row.begin(), row.end()), row.end());
+  if (!row.empty() && row.back() >= upper) {
+    std::ostringstream oss;
+    oss << "Invalid " << name << " target " << row.back() << " of Op " << r
+        << ", it should be less than " << upper << '.';
+    throw error(oss.str());
+  }
+  return row;
+}
+} // namespace
+
+Graph Graph::fromCompressedRows(const std::vector<uint64_t> &outOffsets,
+                                const std::vector<OpAddress> &outs,
+                                const std::vector<uint64_t> &allocOffsets,
+                                const std::vector<AllocAddress> &allocs,
+                                const std::vector<AllocWeight> &allocWeights,
+                                const std::vector<std::string> &opNames) {
+
+  if (outOffsets.empty()) {
+    throw error("outOffsets should contain nOps + 1 elements, not 0");
+  }
+  const uint64_t nOps_    = outOffsets.size() - 1;
+  const uint64_t nAllocs_ = allocWeights.size();
+  assertValidCompressedRows(outOffsets, nOps_, outs.size(), "out");
+  assertValidCompressedRows(allocOffsets, nOps_, allocs.size(), "alloc");
+  if (!opNames.empty() && opNames.size() != nOps_) {
+    std::ostringstream oss;
+    oss << "Expected either 0 or " << nOps_ << " Op names, not "
+        << opNames.size() << '.';
+    throw error(oss.str());
+  }
+
+  std::vector<std::vector<OpAddress>> outRows;
+  std::vector<std::vector<AllocAddress>> allocRows;
+  outRows.reserve(nOps_);
+  allocRows.reserve(nOps_);
+  std::vector<uint64_t> nIns(nOps_, 0);
+  std::vector<uint64_t> nAllocOps(nAllocs_, 0);
+  for (OpAddress i = 0; i < nOps_; ++i) {
+    outRows.push_back(getCompressedRow(outOffsets, outs, i, nOps_, "out"));
+    for (auto out : outRows.back()) {
+      ++nIns[out];
+    }
+    allocRows.push_back(
+        getCompressedRow(allocOffsets, allocs, i, nAllocs_, "alloc"));
+    for (auto alloc : allocRows.back()) {
+      ++nAllocOps[alloc];
+    }
+  }
+
+  // As Ops are processed in increasing order, the ins of each Op and the
+  // Ops of each Alloc are sorted.
+  std::vector<std::vector<OpAddress>> inRows(nOps_);
+  for (OpAddress i = 0; i < nOps_; ++i) {
+    inRows[i].reserve(nIns[i]);
+  }
+  std::vector<std::vector<OpAddress>> allocOps(nAllocs_);
+  for (AllocAddress a = 0; a < nAllocs_; ++a) {
+    allocOps[a].reserve(nAllocOps[a]);
+  }
+  for (OpAddress i = 0; i < nOps_; ++i) {
+    for (auto out : outRows[i]) {
+      inRows[out].push_back(i);
+    }
+    for (auto alloc : allocRows[i]) {
+      allocOps[alloc].push_back(i);
+    }
+  }
+
+  Graph g;
+  g.reserve(nOps_, nAllocs_);
+  for (OpAddress i = 0; i < nOps_; ++i) {
+    const auto debugStringId = opNames.empty()
+                                   ? util::StringPool::EmptyId
+                                   : g.debugStrings.intern(opNames[i]);
+    g.allOps.emplace_back(i,
+                          std::move(inRows[i]),
+                          std::move(outRows[i]),
+                          std::move(allocRows[i]),
+                          debugStringId);
+  }
+  for (AllocAddress a = 0; a < nAllocs_; ++a) {
+    g.allAllocs.emplace_back(a, allocWeights[a], std::move(allocOps[a]));
+  }
+  g.isFinalized = true;
+  return g;
+}
+
 void Graph::append(std::ostream &ost) const {
   for (auto op : getOps()) {
-    ost << '\n' << op.getDebugString() << "   <-  [";
+    ost << '\n' << getDebugString(op.getAddress()) << "   <-  [";
     for (auto inAdd : op.getIns()) {
-      ost << ' ' << getOp(inAdd).getDebugString() << ' ';
+      ost << ' ' << getDebugString(inAdd) << ' ';
     }
     ost << ']';
   }
 }
 
-std::vector<AllocWeight> Graph::getFwdRippleCosts(ScheduleIndex start0,
-                                                  int nToShift,
-                                                  int firstExtCon) const {
+template <typename W>
+const std::vector<W> &
+Graph::getFwdRippleCosts(ScheduleIndex start0,
+                         int nToShift,
+                         int firstExtCon,
+                         RippleScratch<W> &rippleScratch) const {
 
   const int sign             = +1;
   const auto nCostsToCompute = firstExtCon - nToShift - start0;
   const auto dirOffset       = nToShift - 1;
-  return getRippleCosts(start0, nToShift, sign, nCostsToCompute, dirOffset);
+  return getRippleCosts(
+      start0, nToShift, sign, nCostsToCompute, dirOffset, rippleScratch);
 }
 
-AllocWeight Graph::getShiftCost(ScheduleIndex start0,
-                                ScheduleIndex start1,
-                                int nToShift,
-                                const Alloc &alloc) const {
+template <typename W>
+W Graph::getShiftCost(ScheduleIndex start0,
+                      ScheduleIndex start1,
+                      int nToShift,
+                      AllocAddress allocAddress) const {
 
   // rotate the problem so that start0 < start1
   if (start1 < start0) {
@@ -244,7 +707,7 @@ AllocWeight Graph::getShiftCost(ScheduleIndex start0,
     nToShift  = old0 - old1;
   }
 
-  AllocWeight fwdShiftCost = AllocWeight::negativeOne();
+  W fwdShiftCost = W(-1);
 
   // example:
   //
@@ -283,8 +746,7 @@ AllocWeight Graph::getShiftCost(ScheduleIndex start0,
   // how much each o is shifted backward
   auto bwdShift = nToShift;
 
-  auto allocWeight  = alloc.getWeight();
-  auto allocAddress = alloc.getAddress();
+  const auto allocWeight = getRippleWeight<W>(allocAddress);
 
   // current alloc liveneness range
   auto a0 = allocToFirstSchedule(allocAddress);
@@ -304,12 +766,12 @@ AllocWeight Graph::getShiftCost(ScheduleIndex start0,
 
   //  ..         ,,          .,
   if (a1 < x0 || o1 <= a0 || (a0 < x0 && o1 <= a1)) {
-    fwdShiftCost = AllocWeight(0);
+    fwdShiftCost = W(0);
   }
 
   //        xx                       oo
   else if ((x0 <= a0 && a1 < o0) || (o0 <= a0 && a1 < o1)) {
-    fwdShiftCost = AllocWeight(0);
+    fwdShiftCost = W(0);
   }
 
   // .x
@@ -442,16 +904,20 @@ ScheduleIndex Graph::getFirstConsumer(ScheduleIndex start,
   return upper;
 }
 
-ShiftAndCost Graph::getBestShiftRippleAlgo(const ScheduleIndex start,
-                                           const int nToShift) const {
+template <typename W>
+ShiftAndCost
+Graph::getBestShiftRippleAlgo(const ScheduleIndex start,
+                              const int nToShift,
+                              RippleScratch<W> &rippleScratch) const {
 
   ScheduleIndex bestShift{0};
-  AllocWeight bestCost{0};
+  W bestCost{0};
 
   // see comment-I for how this bound works
   if (getNCanBwd(start) >= nToShift) {
     ScheduleIndex lastProducer = start - getNCanBwd(start) - 1;
-    auto bwdCosts = getBwdRippleCosts(start, nToShift, lastProducer);
+    const auto &bwdCosts =
+        getBwdRippleCosts(start, nToShift, lastProducer, rippleScratch);
     for (ScheduleIndex proposedStart = lastProducer + 1;
          proposedStart < start;
          ++proposedStart) {
@@ -471,7 +937,8 @@ ShiftAndCost Graph::getBestShiftRippleAlgo(const ScheduleIndex start,
   if (getNCanFwd(start) >= nToShift) {
     // [start + 1, firstConsumer - nToShift]
     ScheduleIndex firstConsumer = start + getNCanFwd(start) + nToShift;
-    auto fwdCosts = getFwdRippleCosts(start, nToShift, firstConsumer);
+    const auto &fwdCosts =
+        getFwdRippleCosts(start, nToShift, firstConsumer, rippleScratch);
     for (uint64_t i = 0; i < fwdCosts.size(); ++i) {
       int shift = static_cast<int>(i) + 1;
       if (fwdCosts[i] < bestCost &&
@@ -482,27 +949,267 @@ ShiftAndCost Graph::getBestShiftRippleAlgo(const ScheduleIndex start,
     }
   }
 
-  ShiftAndCost best{bestShift, bestCost};
+  ShiftAndCost best{bestShift, toAllocWeight(bestCost)};
+  return best;
+}
+
+template <typename W>
+const std::vector<ShiftAndCost> &
+Graph::getAllShiftsRippleAlgo(const ScheduleIndex start,
+                              const int nToShift,
+                              RippleScratch<W> &rippleScratch) const {
+
+  auto &shifts = rippleScratch.shifts;
+  shifts.clear();
+
+  // see comment-I for how this bound works
+  if (getNCanBwd(start) >= nToShift) {
+    ScheduleIndex lastProducer = start - getNCanBwd(start) - 1;
+    const auto &bwdCosts =
+        getBwdRippleCosts(start, nToShift, lastProducer, rippleScratch);
+    for (ScheduleIndex proposedStart = lastProducer + 1;
+         proposedStart < start;
+         ++proposedStart) {
+      auto bwdCostIndex = static_cast<uint64_t>(start - 1 - proposedStart);
+      if (isLinkPreserving(proposedStart,
+                           proposedStart + nToShift,
+                           start - proposedStart)) {
+        shifts.push_back({proposedStart - start,
+                          toAllocWeight(bwdCosts[bwdCostIndex])});
+      }
+    }
+  }
+
+  // see comment-I for how this bound works
+  if (getNCanFwd(start) >= nToShift) {
+    ScheduleIndex firstConsumer = start + getNCanFwd(start) + nToShift;
+    const auto &fwdCosts =
+        getFwdRippleCosts(start, nToShift, firstConsumer, rippleScratch);
+    for (uint64_t i = 0; i < fwdCosts.size(); ++i) {
+      int shift = static_cast<int>(i) + 1;
+      if (isLinkPreserving(start, start + shift, nToShift)) {
+        shifts.push_back({shift, toAllocWeight(fwdCosts[i])});
+      }
+    }
+  }
+
+  return shifts;
+}
+
+namespace {
+// The ranges [x0, o0) and [o0, o1) which are swapped by a ScheduleChange
+std::array<ScheduleIndex, 3> getSwapRanges(const ScheduleChange &change) {
+  const auto canonical = change.getCanonical();
+  const auto x0        = canonical.getStart0();
+  const auto o0        = x0 + canonical.getNToShift();
+  const auto o1        = canonical.getStart1() + canonical.getNToShift();
+  return {x0, o0, o1};
+}
+} // namespace
+
+const std::vector<Graph::IntervalChange> &
+Graph::getIntervalChanges(ScheduleIndex x0,
+                          ScheduleIndex o0,
+                          ScheduleIndex o1,
+                          PeakScratch &scratch) const {
+
+  // the new schedule index of an Op at schedule index i
+  auto moved = [x0, o0, o1](ScheduleIndex i) {
+    if (i < x0 || i >= o1) {
+      return i;
+    }
+    return i < o0 ? i + (o1 - o0) : i - (o0 - x0);
+  };
+
+  auto &changes = scratch.changes;
+  changes.clear();
+  getAllocAddresses(x0, o1, scratch.allocs);
+  for (auto allocAddress : scratch.allocs) {
+    const auto &schedules = allocToSchedule(allocAddress);
+    auto first1           = moved(schedules.front());
+    auto final1           = first1;
+    for (auto i : schedules) {
+      first1 = std::min(first1, moved(i));
+      final1 = std::max(final1, moved(i));
+    }
+    if (first1 != schedules.front() || final1 != schedules.back()) {
+      changes.push_back({allocAddress,
+                         schedules.front(),
+                         schedules.back(),
+                         first1,
+                         final1});
+    }
+  }
+  return changes;
+}
+
+std::array<AllocWeight, 2>
+Graph::getRangeMaxima(ScheduleIndex x0,
+                      ScheduleIndex o0,
+                      ScheduleIndex o1,
+                      PeakScratch &scratch) const {
+
+  // The change in liveness is confined to [x0, o1), and is piecewise
+  // constant between the (clipped) ends of the changed intervals.
+  auto &events = scratch.events;
+  events.clear();
+  for (const auto &change : getIntervalChanges(x0, o0, o1, scratch)) {
+    const auto w = getAllocWeight(change.alloc);
+    events.push_back({std::max(change.first1, x0), w});
+    events.push_back({std::min(change.final1 + 1, o1), -1 * w});
+    events.push_back({std::max(change.first0, x0), -1 * w});
+    events.push_back({std::min(change.final0 + 1, o1), w});
+  }
+  std::sort(events.begin(),
+            events.end(),
+            [](const auto &a, const auto &b) {
+              return std::get<0>(a) < std::get<0>(b);
+            });
+
+  // The old and new maxima are computed from the same range queries, so that
+  // they are exactly equal if the maximum is unaffected.
+  auto oldMax = -1.0 * AllocWeight::numericMaxLimit();
+  auto newMax = oldMax;
+  auto update = [&oldMax, &newMax](AllocWeight m, AllocWeight delta) {
+    oldMax = std::max(oldMax, m);
+    newMax = std::max(newMax, m + delta);
+  };
+
+  const auto &peak = schToLiveness;
+  auto delta = AllocWeight::zero();
+  uint64_t e{0};
+  auto begin = x0;
+  while (begin < o1) {
+    while (e < events.size() && std::get<0>(events[e]) == begin) {
+      delta += std::get<1>(events[e]);
+      ++e;
+    }
+    const auto end = e < events.size() ? std::get<0>(events[e]) : o1;
+    update(peak.rangeMax(static_cast<uint64_t>(begin),
+                         static_cast<uint64_t>(end)),
+           delta);
+    begin = end;
+  }
+
+  return {oldMax, newMax};
+}
+
+AllocWeight Graph::getPeakChange(ScheduleIndex x0,
+                                 ScheduleIndex o0,
+                                 ScheduleIndex o1,
+                                 PeakScratch &scratch) const {
+
+  // The liveness outside of [x0, o1) is unchanged
+  const auto &peak = schToLiveness;
+  auto outside     = peak.rangeMax(static_cast<uint64_t>(o1), peak.size());
+  if (x0 > 0) {
+    outside =
+        std::max(outside, peak.rangeMax(0, static_cast<uint64_t>(x0)));
+  }
+  const auto maxima = getRangeMaxima(x0, o0, o1, scratch);
+  return std::max(outside, maxima[1]) - std::max(outside, maxima[0]);
+}
+
+bool Graph::exceedsLivenessCap(const ScheduleChange &change,
+                               PeakScratch &scratch) const {
+  if (!hasLivenessCap()) {
+    return false;
+  }
+  const auto ranges = getSwapRanges(change);
+  const auto maxima =
+      getRangeMaxima(ranges[0], ranges[1], ranges[2], scratch);
+  return getLivenessCap() < maxima[1] && maxima[0] < maxima[1];
+}
+
+template <typename W>
+ShiftAndCost
+Graph::getBestShiftCappedAlgo(const ScheduleIndex start,
+                              const int nToShift,
+                              RippleScratch<W> &rippleScratch) const {
+  ShiftAndCost best{0, AllocWeight::zero()};
+  for (const auto &candidate :
+       getAllShiftsRippleAlgo(start, nToShift, rippleScratch)) {
+    if (candidate.getCost() < best.getCost() &&
+        !exceedsLivenessCap({start, start + candidate.getShift(), nToShift},
+                            rippleScratch)) {
+      best = candidate;
+    }
+  }
   return best;
 }
 
-std::vector<AllocAddress> Graph::getAllocAddresses(ScheduleIndex start,
-                                                   ScheduleIndex end) const {
-  std::vector<AllocAddress> addresses;
-  auto nAddressEstimate = static_cast<uint64_t>(2 * (end - start));
-  addresses.reserve(nAddressEstimate);
+template <typename W>
+ShiftAndCost Graph::getBestShiftPeakAlgo(const ScheduleIndex start,
+                                         const int nToShift,
+                                         LivenessObjective objective,
+                                         double maxWeight,
+                                         RippleScratch<W> &rippleScratch,
+                                         AllocWeight &sumCost) const {
+
+  // the objective of a shift, as (change in max, change in sum)
+  auto isBetter = [objective, maxWeight](const AllocWeight &max0,
+                                         const AllocWeight &sum0,
+                                         const AllocWeight &max1,
+                                         const AllocWeight &sum1) {
+    if (objective == LivenessObjective::MAX) {
+      return max0 < max1 || (max0 == max1 && sum0 < sum1);
+    }
+    return sum0 + maxWeight * max0 < sum1 + maxWeight * max1;
+  };
+
+  // The liveness outside of [x0, o1) is unchanged by a shift, which gives a
+  // lower bound on the change in max liveness in O(log n). Only candidates
+  // which might be better than the best with this bound are evaluated
+  // exactly, which requires a sweep over [x0, o1).
+  const auto &peak = schToLiveness;
+  auto getMaxCostLowerBound = [&peak](ScheduleIndex x0, ScheduleIndex o1) {
+    auto outside = peak.rangeMax(static_cast<uint64_t>(o1), peak.size());
+    if (x0 > 0) {
+      outside = std::max(outside,
+                         peak.rangeMax(0, static_cast<uint64_t>(x0)));
+    }
+    return outside - peak.max();
+  };
+
+  ScheduleIndex bestShift{0};
+  auto bestMax = AllocWeight::zero();
+  auto bestSum = AllocWeight::zero();
+  for (const auto &candidate :
+       getAllShiftsRippleAlgo(start, nToShift, rippleScratch)) {
+    const auto ranges =
+        getSwapRanges({start, start + candidate.getShift(), nToShift});
+    const auto lowerBound = getMaxCostLowerBound(ranges[0], ranges[2]);
+    if (!isBetter(lowerBound, candidate.getCost(), bestMax, bestSum)) {
+      continue;
+    }
+    const auto maxCost =
+        getPeakChange(ranges[0], ranges[1], ranges[2], rippleScratch);
+    if (isBetter(maxCost, candidate.getCost(), bestMax, bestSum) &&
+        !exceedsLivenessCap({start, start + candidate.getShift(), nToShift},
+                            rippleScratch)) {
+      bestShift = candidate.getShift();
+      bestMax   = maxCost;
+      bestSum   = candidate.getCost();
+    }
+  }
+
+  sumCost = bestSum;
+  if (objective == LivenessObjective::MAX) {
+    return {bestShift, bestMax != AllocWeight::zero() ? bestMax : bestSum};
+  }
+  return {bestShift, bestSum + maxWeight * bestMax};
+}
+
+void Graph::getAllocAddresses(ScheduleIndex start,
+                              ScheduleIndex end,
+                              util::EpochSet &allocs) const {
+  allocs.clear();
   for (ScheduleIndex scheduleIndex = start; scheduleIndex < end;
        ++scheduleIndex) {
     for (AllocAddress allocAddress : scheduleToAllocs(scheduleIndex)) {
-      addresses.push_back(allocAddress);
+      allocs.insert(allocAddress);
     }
   }
-  std::sort(addresses.begin(), addresses.end());
-
-  // profiling reveals this is faster than the map -> vector approach
-  auto last = std::unique(addresses.begin(), addresses.end());
-  addresses.erase(last, addresses.cend());
-  return addresses;
 }
 
 std::vector<OpAddress> Graph::getInputOps() const {
@@ -546,19 +1253,25 @@ std::string Graph::getLivenessString() const {
     auto address   = schToOp[i];
     const auto &op = getOp(address);
 
+    auto asVector = [](util::Span<const ScheduleIndex> x) {
+      return std::vector<ScheduleIndex>(x.cbegin(), x.cend());
+    };
+
     std::ostringstream ossIns;
-    poprithms::util::append(ossIns, opToInSch[address]);
+    poprithms::util::append(ossIns, asVector(opToInSch[address]));
     std::ostringstream ossLinkTo;
     ossLinkTo << (op.hasForwardLink() ? '+' : ' ');
     std::ostringstream ossName;
-    ossName << getOp(address).getDebugString();
+    ossName << getDebugString(address);
     std::ostringstream ossOuts;
-    poprithms::util::append(ossOuts, opToOutSch[address]);
+    poprithms::util::append(ossOuts, asVector(opToOutSch[address]));
     std::ostringstream ossAllocs;
-    poprithms::util::append(ossAllocs, schToAllocs[i]);
+    const auto allocs = schToAllocs[i];
+    poprithms::util::append(
+        ossAllocs, std::vector<AllocAddress>(allocs.cbegin(), allocs.cend()));
 
     sIndex.push_back(std::to_string(i));
-    sLiveness.push_back(toString(schToLiveness[i]));
+    sLiveness.push_back(toString(scheduleToLiveness(i)));
     sIns.push_back(ossIns.str());
     sLinkTo.push_back(ossLinkTo.str());
     sOuts.push_back(ossOuts.str());
@@ -586,19 +1299,70 @@ std::string Graph::getLivenessString() const {
         << '\n';
   }
 
-  AllocWeight total = std::accumulate(
-      schToLiveness.cbegin(), schToLiveness.cend(), AllocWeight(0));
-  oss << "Total : " << total << '\n';
+  oss << "Total : " << getSumLiveness() << '\n';
 
   return oss.str();
 }
 
-AllocAddress Graph::insertAlloc(AllocWeight w) {
+AllocAddress Graph::insertAlloc(AllocWeight w, ResourceClass r) {
   AllocAddress a = allAllocs.size();
-  allAllocs.push_back({a, w});
+  allAllocs.push_back({a, w, r});
   return a;
 }
 
+void Graph::setResourceWeight(ResourceClass r, double w) {
+  if (isInitialized) {
+    throw error("setResourceWeight cannot be called once the Graph is "
+                "initialized");
+  }
+  if (resourceWeights.size() <= r) {
+    resourceWeights.resize(r + 1, 1.0);
+  }
+  resourceWeights[r] = w;
+}
+
+uint64_t Graph::nResourceClasses() const {
+  uint64_t n{1};
+  for (const auto &alloc : getAllocs()) {
+    n = std::max<uint64_t>(n, alloc.getResourceClass() + 1);
+  }
+  return n;
+}
+
+std::vector<AllocWeight> Graph::getResourceLiveness(ResourceClass r) const {
+  // The change in liveness at each schedule index, accumulated below
+  std::vector<AllocWeight> liveness(nOps() + 1, AllocWeight::zero());
+  for (const auto &alloc : getAllocs()) {
+    if (alloc.nOps() > 0 && alloc.getResourceClass() == r) {
+      const auto a = alloc.getAddress();
+      liveness[static_cast<uint64_t>(allocToFirstSchedule(a))] +=
+          alloc.getWeight();
+      liveness[static_cast<uint64_t>(allocToFinalSchedule(a)) + 1] -=
+          alloc.getWeight();
+    }
+  }
+  for (uint64_t i = 1; i < nOps(); ++i) {
+    liveness[i] += liveness[i - 1];
+  }
+  liveness.pop_back();
+  return liveness;
+}
+
+AllocWeight Graph::getSumLiveness(ResourceClass r) const {
+  auto sum = AllocWeight::zero();
+  for (const auto &liveness : getResourceLiveness(r)) {
+    sum += liveness;
+  }
+  return sum;
+}
+
+AllocWeight Graph::getMaxLiveness(ResourceClass r) const {
+  const auto liveness = getResourceLiveness(r);
+  return liveness.empty()
+             ? AllocWeight::zero()
+             : *std::max_element(liveness.cbegin(), liveness.cend());
+}
+
 template <typename T>
 void rotate(T &t, ScheduleIndex x0, ScheduleIndex o0, ScheduleIndex o1) {
   auto t0 = std::next(t.begin(), x0);
@@ -621,7 +1385,15 @@ void Graph::applyChange(const ScheduleChange &scheduleChange) {
   auto o0 = canonStart0 + canonNToShift;
   auto o1 = canonStart1 + canonNToShift;
 
-  auto touchedAllocs = getAllocAddresses(x0, o1);
+  if (applyChangeAllocs.universeSize() != nAllocs()) {
+    applyChangeAllocs.setUniverseSize(nAllocs());
+  }
+  if (applyChangeConsumers.universeSize() != nOps()) {
+    applyChangeConsumers.setUniverseSize(nOps());
+    applyChangeProducers.setUniverseSize(nOps());
+  }
+
+  getAllocAddresses(x0, o1, applyChangeAllocs);
 
   // An example of std::rotate
   //
@@ -645,52 +1417,62 @@ void Graph::applyChange(const ScheduleChange &scheduleChange) {
     opToSch[scheduleToOp(i)] = i;
   }
 
-  // 2 allocToSch
-  for (auto allocAddress : touchedAllocs) {
+  // 2 allocToSch, and the liveness within [x0, o1)
+  for (auto allocAddress : applyChangeAllocs) {
+    const auto first0 = allocToFirstSchedule(allocAddress);
+    const auto final0 = allocToFinalSchedule(allocAddress);
     setAllocToSch(allocAddress);
+    updateLiveness(allocAddress, first0, final0);
   }
 
   // 3 schToAllocs
-  rotate(schToAllocs, x0, o0, o1);
+  schToAllocs.rotateRows(static_cast<uint64_t>(x0),
+                         static_cast<uint64_t>(o0),
+                         static_cast<uint64_t>(o1));
 
-  std::vector<OpAddress> consumersTouched;
-  auto estimateOfNEdges = static_cast<uint64_t>(2 * (o1 - x0));
-  consumersTouched.reserve(estimateOfNEdges);
+  applyChangeConsumers.clear();
+  applyChangeProducers.clear();
   for (ScheduleIndex i = x0; i < o1; ++i) {
-    for (auto outAddress : getOp(scheduleToOp(i)).getOuts()) {
-      consumersTouched.push_back(outAddress);
+    const auto &op = getOp(scheduleToOp(i));
+    for (auto outAddress : op.getOuts()) {
+      applyChangeConsumers.insert(outAddress);
     }
-  }
-  std::sort(consumersTouched.begin(), consumersTouched.end());
-  auto lastConsumer =
-      std::unique(consumersTouched.begin(), consumersTouched.end());
-  consumersTouched.erase(lastConsumer, consumersTouched.end());
-
-  std::vector<OpAddress> producersTouched;
-  producersTouched.reserve(estimateOfNEdges);
-  for (ScheduleIndex i = x0; i < o1; ++i) {
-    for (auto inAddress : getOp(scheduleToOp(i)).getIns()) {
-      producersTouched.push_back(inAddress);
+    for (auto inAddress : op.getIns()) {
+      applyChangeProducers.insert(inAddress);
     }
   }
-  std::sort(producersTouched.begin(), producersTouched.end());
-  auto lastProducer =
-      std::unique(producersTouched.begin(), producersTouched.end());
-  producersTouched.erase(lastProducer, producersTouched.end());
 
   // 4 opToInSch
-  for (OpAddress consumerAddress : consumersTouched) {
+  for (OpAddress consumerAddress : applyChangeConsumers) {
     setOpToInSch(consumerAddress);
   }
 
   // 5 opToOutSch
-  for (OpAddress producerAddress : producersTouched) {
+  for (OpAddress producerAddress : applyChangeProducers) {
     setOpToOutSch(producerAddress);
   }
 
   // 6 nCanFwd and nCanBwd
-  updateNCanFwds(nToShift, x0, o1, producersTouched);
-  updateNCanBwds(nToShift, x0, o1, consumersTouched);
+  updateNCanFwds(nToShift, x0, o1, applyChangeProducers.get());
+  updateNCanBwds(nToShift, x0, o1, applyChangeConsumers.get());
+}
+
+void Graph::updateLiveness(AllocAddress allocAddress,
+                           ScheduleIndex first0,
+                           ScheduleIndex final0) {
+  const auto first1 = allocToFirstSchedule(allocAddress);
+  const auto final1 = allocToFinalSchedule(allocAddress);
+  if (first0 == first1 && final0 == final1) {
+    return;
+  }
+  const auto w = getAllocWeight(allocAddress);
+  schToLiveness.rangeAdd(static_cast<uint64_t>(first0),
+                         static_cast<uint64_t>(final0 + 1),
+                         -1 * w);
+  schToLiveness.rangeAdd(static_cast<uint64_t>(first1),
+                         static_cast<uint64_t>(final1 + 1),
+                         w);
+  sumLiveness += ((final1 - first1) - (final0 - first0)) * w;
 }
 
 void Graph::updateSusceptible(ScheduleIndex a, ScheduleIndex b) {
@@ -701,19 +1483,26 @@ void Graph::updateSusceptible(ScheduleIndex a, ScheduleIndex b) {
     const auto opAddress = scheduleToOp(i);
     for (auto inAddress : getOp(opAddress).getIns()) {
       if (opToSchedule(inAddress) < a) {
-        susceptible[inAddress] = true;
-        susceptible[opAddress] = true;
+        setSusceptible(inAddress);
+        setSusceptible(opAddress);
       }
     }
     for (auto outAddress : getOp(opAddress).getOuts()) {
       if (opToSchedule(outAddress) >= b) {
-        susceptible[outAddress] = true;
-        susceptible[opAddress]  = true;
+        setSusceptible(outAddress);
+        setSusceptible(opAddress);
       }
     }
   }
 }
 
+void Graph::setSusceptible(OpAddress a) {
+  if (!susceptible[a]) {
+    susceptible[a] = true;
+    susceptibleList.push_back(a);
+  }
+}
+
 // TODO(T14827) : there's a faster way to do this when n2s = 1, will be
 // useful when multi-threading as fast updating will become important
 void Graph::updateNCanFwds(int n2s,
@@ -760,20 +1549,30 @@ void Graph::updateNCanBwds(int n2s,
   }
 }
 
+namespace {
+std::vector<AllocWeight>
+getPartialSums(const std::vector<AllocWeight> &deltaLiveness) {
+  std::vector<AllocWeight> liveness;
+  liveness.reserve(deltaLiveness.size());
+  liveness.push_back(deltaLiveness[0]);
+  for (uint64_t i = 1; i < deltaLiveness.size(); ++i) {
+    liveness.push_back(liveness.back() + deltaLiveness[i]);
+  }
+  return liveness;
+}
+} // namespace
+
 void Graph::setSchToLiveness() {
-  schToLiveness.reserve(nOps());
-  schToLiveness.clear();
-  auto deltaLiveness = getDeltaLiveness();
-  schToLiveness.push_back(deltaLiveness[0]);
-  for (uint64_t i = 0; i < nOps(); ++i) {
-    schToLiveness.push_back(schToLiveness.back() + deltaLiveness[i + 1]);
-  }
+  const auto liveness = getPartialSums(getDeltaLiveness());
+  schToLiveness       = util::SegmentTree<AllocWeight>(liveness);
+  sumLiveness =
+      std::accumulate(liveness.cbegin(), liveness.cend(), AllocWeight(0));
 }
 
 bool Graph::isSchedulable() const {
 
   if (hasAtLeastOneLink()) {
-    auto merged      = getLinkMerged();
+    auto merged      = getLinkMerged(false);
     auto &childGraph = std::get<0>(merged);
     return childGraph.isSchedulable();
   }
@@ -812,23 +1611,25 @@ bool Graph::isSchedulable() const {
   return nScheduled == nOps_i32();
 }
 
-Graph::OpMerged Graph::getLinkMerged() const {
-  return getMerged(getLinkChains());
+Graph::OpMerged Graph::getLinkMerged(bool withDebugStrings) const {
+  return getMerged(getLinkChains(), withDebugStrings);
 }
 
-Graph::OpMerged Graph::getTightMerged() const {
-  return getMerged(getTightChains());
+Graph::OpMerged Graph::getTightMerged(bool withDebugStrings) const {
+  return getMerged(getTightChains(), withDebugStrings);
 }
 
-Graph::OpMerged
-Graph::getMerged(std::vector<std::vector<OpAddress>> chains) const {
+Graph::OpMerged Graph::getMerged(std::vector<std::vector<OpAddress>> chains,
+                                 bool withDebugStrings) const {
 
   Graph childGraph;
 
   // The Allocs are the same in the child Graph as the parent Graph
   for (const auto &parentAlloc : getAllocs()) {
-    childGraph.insertAlloc(parentAlloc.getWeight());
+    childGraph.insertAlloc(parentAlloc.getWeight(),
+                           parentAlloc.getResourceClass());
   }
+  childGraph.resourceWeights = resourceWeights;
 
   constexpr OpAddress None{std::numeric_limits<OpAddress>::max()};
 
@@ -858,7 +1659,12 @@ Graph::getMerged(std::vector<std::vector<OpAddress>> chains) const {
 
   const auto nChildOps = childOpAddress;
 
+  childGraph.reserve(nChildOps, nAllocs());
   for (uint64_t childAddress = 0; childAddress < nChildOps; ++childAddress) {
+    if (!withDebugStrings) {
+      childGraph.insertOp(std::string{});
+      continue;
+    }
     // The child Op's name is a concatenation of the names of the parent Ops
     const auto &parentAddresses = childToParents[childAddress];
     std::ostringstream ossChildName;
@@ -867,7 +1673,7 @@ Graph::getMerged(std::vector<std::vector<OpAddress>> chains) const {
       if (i != 0) {
         ossChildName << ' ';
       }
-      ossChildName << getOp(parentAddresses[i]).getDebugString();
+      ossChildName << getDebugString(parentAddresses[i]);
     }
     ossChildName << ')';
     auto name = ossChildName.str();
@@ -916,23 +1722,29 @@ std::vector<std::vector<OpAddress>> Graph::getLinkChains() const {
   return chains;
 }
 
-void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
+std::vector<OpAddress> Graph::kahn(KahnTieBreaker kahnTie,
+                                  uint32_t kahnSeed) const {
 
-  schToOp.reserve(nOps());
-  schToOp.clear();
+  std::vector<OpAddress> schedule;
+  schedule.reserve(nOps());
 
   if (hasAtLeastOneLink()) {
-    auto merged                = getLinkMerged();
+    auto merged                = getLinkMerged(false);
     auto &childGraph           = std::get<0>(merged);
     const auto &childToParents = std::get<1>(merged);
-    childGraph.kahn(kahnTie, kahnSeed);
-    for (ScheduleIndex i = 0; i < childGraph.nOps(); ++i) {
-      const auto childAddress = childGraph.scheduleToOp(i);
-      schToOp.insert(schToOp.end(),
-                     childToParents[childAddress].cbegin(),
-                     childToParents[childAddress].cend());
+    if (hasLivenessCap()) {
+      childGraph.setLivenessCap(getLivenessCap());
     }
-    return;
+    for (auto childAddress : childGraph.kahn(kahnTie, kahnSeed)) {
+      schedule.insert(schedule.end(),
+                      childToParents[childAddress].cbegin(),
+                      childToParents[childAddress].cend());
+    }
+    return schedule;
+  }
+
+  if (hasLivenessCap()) {
+    return kahnCapped(kahnTie, kahnSeed);
   }
 
   std::vector<OpAddress> outstanding;
@@ -951,7 +1763,7 @@ void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
     while (!ready.empty()) {
       std::shuffle(ready.begin(), ready.end(), g);
       OpAddress address = ready.back();
-      schToOp.push_back(address);
+      schedule.push_back(address);
       ready.pop_back();
       for (auto cAddress : allOps[address].getOuts()) {
         --outstanding[cAddress];
@@ -965,7 +1777,7 @@ void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
   else if (kahnTie == KahnTieBreaker::FIFO) {
     while (!ready.empty()) {
       OpAddress address = ready.back();
-      schToOp.push_back(address);
+      schedule.push_back(address);
       ready.pop_back();
       for (auto cAddress : allOps[address].getOuts()) {
         --outstanding[cAddress];
@@ -988,7 +1800,7 @@ void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
     auto deltaLive = [&nOutstandingForAlloc, &allocLive, this](OpAddress a) {
       AllocWeight delta{0};
       for (auto allocAddress : getOp(a).getAllocs()) {
-        const auto allocWeight = getAlloc(allocAddress).getWeight();
+        const auto allocWeight = getAllocWeight(allocAddress);
         if (nOutstandingForAlloc[allocAddress] == 1) {
           delta -= allocWeight;
         }
@@ -999,35 +1811,47 @@ void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
       return delta;
     };
 
-    while (!ready.empty()) {
-      std::shuffle(ready.begin(), ready.end(), g);
+    // Ready Ops are ordered by the change in liveness from scheduling them,
+    // with ties broken by a random value drawn when the Op becomes ready.
+    using DeltaAndTieBreak = std::tuple<AllocWeight, uint64_t>;
+    util::IndexedHeap<DeltaAndTieBreak> readyHeap(nOps());
+    auto pushReady = [&readyHeap, &deltaLive, &g](OpAddress a) {
+      readyHeap.push(a, DeltaAndTieBreak{deltaLive(a), g()});
+    };
 
-      auto bestIter         = ready.cbegin();
-      AllocWeight bestDelta = deltaLive(*bestIter);
+    for (auto address : ready) {
+      pushReady(address);
+    }
+
+    while (!readyHeap.empty()) {
+      const auto address = readyHeap.pop();
+      schedule.push_back(address);
 
-      for (auto i = std::next(ready.cbegin(), 1); i != ready.cend(); ++i) {
-        auto candidateDelta = deltaLive(*i);
-        if (candidateDelta < bestDelta) {
-          bestIter  = i;
-          bestDelta = candidateDelta;
-        }
-      }
-      auto address = *bestIter;
-      schToOp.push_back(address);
-      ready.erase(bestIter);
       for (auto allocAddress : getOp(address).getAllocs()) {
+        const bool wasLive = allocLive[allocAddress];
         --nOutstandingForAlloc[allocAddress];
-        if (nOutstandingForAlloc[allocAddress] == 0) {
-          allocLive[allocAddress] = false;
-        } else {
-          allocLive[allocAddress] = true;
+        allocLive[allocAddress] = nOutstandingForAlloc[allocAddress] != 0;
+
+        // The deltaLive of an Op only depends on whether its Allocs are live,
+        // and on which of them have exactly 1 outstanding Op, so ready Ops
+        // only need updating when one of these changes.
+        if (wasLive != allocLive[allocAddress] ||
+            nOutstandingForAlloc[allocAddress] == 1) {
+          for (auto opAddress : getAlloc(allocAddress).getOps()) {
+            if (readyHeap.contains(opAddress)) {
+              readyHeap.update(
+                  opAddress,
+                  DeltaAndTieBreak{deltaLive(opAddress),
+                                   std::get<1>(readyHeap.key(opAddress))});
+            }
+          }
         }
       }
 
       for (auto cAddress : allOps[address].getOuts()) {
         --outstanding[cAddress];
         if (outstanding[cAddress] == 0) {
-          ready.push_back(cAddress);
+          pushReady(cAddress);
         }
       }
     }
@@ -1037,15 +1861,15 @@ void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
     throw error("unrecognised KahnTieBreaker");
   }
 
-  if (schToOp.size() != allOps.size()) {
+  if (schedule.size() != allOps.size()) {
     std::ostringstream oss;
     oss << "Failed to schedule Ops in Graph::initializeSchedule, "
-        << " only managed to schedule " << schToOp.size() << " of "
+        << " only managed to schedule " << schedule.size() << " of "
         << allOps.size() << ". Failed to schedule:\n";
 
     for (const auto &op : allOps) {
-      if (std::find(schToOp.cbegin(), schToOp.cend(), op.getAddress()) ==
-          schToOp.cend()) {
+      if (std::find(schedule.cbegin(), schedule.cend(), op.getAddress()) ==
+          schedule.cend()) {
         oss << "     " << op.getAddress() << " <- { ";
         for (auto x : op.getIns()) {
           oss << x << ' ';
@@ -1055,6 +1879,305 @@ void Graph::kahn(KahnTieBreaker kahnTie, uint32_t kahnSeed) {
     }
     throw error(oss.str());
   }
+  return schedule;
+}
+
+std::vector<OpAddress> Graph::kahnCapped(KahnTieBreaker kahnTie,
+                                        uint32_t kahnSeed) const {
+
+  std::vector<OpAddress> schedule;
+  schedule.reserve(nOps());
+
+  std::mt19937 g(kahnSeed);
+
+  // The liveness of the Allocs which are live after the last scheduled Op.
+  // An Alloc of a ready Op which is not live has not been started.
+  AllocWeight liveness = AllocWeight::zero();
+  std::vector<int> nOutstandingForAlloc(nAllocs());
+  std::vector<bool> allocLive(nAllocs(), false);
+  for (const auto &alloc : getAllocs()) {
+    nOutstandingForAlloc[alloc.getAddress()] = alloc.nOps_i32();
+  }
+
+  auto getStarted = [&allocLive, this](OpAddress a) {
+    AllocWeight started{0};
+    for (auto allocAddress : getOp(a).getAllocs()) {
+      if (!allocLive[allocAddress]) {
+        started += getAllocWeight(allocAddress);
+      }
+    }
+    return started;
+  };
+
+  auto getFinished = [&nOutstandingForAlloc, this](OpAddress a) {
+    AllocWeight finished{0};
+    for (auto allocAddress : getOp(a).getAllocs()) {
+      if (nOutstandingForAlloc[allocAddress] == 1) {
+        finished += getAllocWeight(allocAddress);
+      }
+    }
+    return finished;
+  };
+
+  // Ready Ops which keep the liveness at most the cap are first, ordered by
+  // the tie-breaker. The others are ordered by the liveness at their
+  // schedule index, and so by the weight of the Allocs they start. Ties are
+  // broken by a random value drawn when an Op becomes ready, or for FIFO, by
+  // the order in which Ops become ready (the latest first, as in
+  // kahn(KahnTieBreaker, uint32_t)).
+  //
+  // The ready Ops are kept in heaps, so that each step is O(log(nReady)).
+  // An Op is only re-keyed when one of its Allocs is started or reaches its
+  // final Op, or when a change in liveness moves it across the cap.
+  using Key = std::tuple<AllocWeight, uint64_t>;
+  util::IndexedHeap<Key> fitting(nOps());
+  // The same Ops as fitting, the Op which starts the most weight first
+  util::IndexedHeap<Key> fittingByStarted(nOps());
+  util::IndexedHeap<Key> exceeding(nOps());
+
+  std::vector<uint64_t> tieBreaks(nOps(), 0);
+  std::vector<AllocWeight> started(nOps(), AllocWeight::zero());
+
+  auto fits = [this, &liveness](const AllocWeight &w) {
+    return !(getLivenessCap() < liveness + w);
+  };
+
+  auto insertReady = [kahnTie,
+                      &fitting,
+                      &fittingByStarted,
+                      &exceeding,
+                      &tieBreaks,
+                      &started,
+                      &fits,
+                      &getStarted,
+                      &getFinished](OpAddress a) {
+    started[a] = getStarted(a);
+    if (!fits(started[a])) {
+      exceeding.push(a, Key{started[a], tieBreaks[a]});
+      return;
+    }
+    fitting.push(a,
+                 Key{kahnTie == KahnTieBreaker::GREEDY
+                         ? started[a] - getFinished(a)
+                         : AllocWeight::zero(),
+                     tieBreaks[a]});
+    fittingByStarted.push(
+        a, Key{AllocWeight::zero() - started[a], tieBreaks[a]});
+  };
+
+  auto removeReady = [&fitting, &fittingByStarted, &exceeding](OpAddress a) {
+    if (exceeding.contains(a)) {
+      exceeding.remove(a);
+    } else {
+      fitting.remove(a);
+      fittingByStarted.remove(a);
+    }
+  };
+
+  uint64_t nReadied{0};
+  auto pushReady = [&tieBreaks, &nReadied, &g, &insertReady, kahnTie](
+                       OpAddress a) {
+    tieBreaks[a] = kahnTie == KahnTieBreaker::FIFO
+                       ? std::numeric_limits<uint64_t>::max() - nReadied
+                       : g();
+    ++nReadied;
+    insertReady(a);
+  };
+
+  std::vector<OpAddress> outstanding;
+  outstanding.reserve(nOps());
+  for (OpAddress i = 0; i < allOps.size(); ++i) {
+    outstanding.push_back(getOp(i).nIns());
+    if (outstanding[i] == 0) {
+      pushReady(i);
+    }
+  }
+
+  // Ready Ops whose Allocs have changed, to be re-keyed once the liveness
+  // after the scheduled Op is known
+  std::vector<OpAddress> stale;
+
+  while (!fitting.empty() || !exceeding.empty()) {
+    OpAddress address;
+    if (!fitting.empty()) {
+      address = fitting.pop();
+      fittingByStarted.remove(address);
+    } else {
+      address = exceeding.pop();
+    }
+    schedule.push_back(address);
+
+    liveness += started[address];
+    stale.clear();
+    for (auto allocAddress : getOp(address).getAllocs()) {
+      const bool wasLive = allocLive[allocAddress];
+      --nOutstandingForAlloc[allocAddress];
+      allocLive[allocAddress] = nOutstandingForAlloc[allocAddress] != 0;
+      if (!allocLive[allocAddress]) {
+        liveness -= getAllocWeight(allocAddress);
+      }
+      if (wasLive != allocLive[allocAddress] ||
+          nOutstandingForAlloc[allocAddress] == 1) {
+        for (auto opAddress : getAlloc(allocAddress).getOps()) {
+          if (fitting.contains(opAddress) || exceeding.contains(opAddress)) {
+            removeReady(opAddress);
+            stale.push_back(opAddress);
+          }
+        }
+      }
+    }
+    for (auto opAddress : stale) {
+      insertReady(opAddress);
+    }
+
+    // Ops whose started weight no longer fits under the cap, and then those
+    // whose started weight now does
+    while (!fittingByStarted.empty() &&
+           !fits(started[fittingByStarted.top()])) {
+      const auto a = fittingByStarted.top();
+      removeReady(a);
+      insertReady(a);
+    }
+    while (!exceeding.empty() && fits(started[exceeding.top()])) {
+      const auto a = exceeding.top();
+      removeReady(a);
+      insertReady(a);
+    }
+
+    for (auto cAddress : allOps[address].getOuts()) {
+      --outstanding[cAddress];
+      if (outstanding[cAddress] == 0) {
+        pushReady(cAddress);
+      }
+    }
+  }
+
+  if (schedule.size() != nOps()) {
+    std::ostringstream oss;
+    oss << "Failed to schedule Ops in Graph::kahnCapped, only managed to "
+        << "schedule " << schedule.size() << " of " << nOps()
+        << ". Is there a cycle?";
+    throw error(oss.str());
+  }
+  return schedule;
+}
+
+std::vector<std::array<ScheduleIndex, 2>>
+Graph::getLivenessCapViolations() const {
+  std::vector<std::array<ScheduleIndex, 2>> violations;
+  if (!hasLivenessCap()) {
+    return violations;
+  }
+  for (ScheduleIndex i = 0; i < nOps_i32(); ++i) {
+    if (getLivenessCap() < scheduleToLiveness(i)) {
+      if (violations.empty() || violations.back()[1] != i) {
+        violations.push_back({i, i + 1});
+      } else {
+        violations.back()[1] = i + 1;
+      }
+    }
+  }
+  return violations;
+}
+
+void Graph::assertSingleResourceClass() const {
+  if (nResourceClasses() > 1) {
+    std::ostringstream oss;
+    oss << "The liveness cap is not supported for Graphs with more than one "
+        << "ResourceClass, this Graph has " << nResourceClasses();
+    throw error(oss.str());
+  }
+}
+
+void Graph::assertLivenessCapMet() const {
+  const auto violations = getLivenessCapViolations();
+  if (violations.empty()) {
+    return;
+  }
+
+  // The Ops listed are limited, as the range may be long
+  constexpr ScheduleIndex maxOpsListed{16};
+  const auto start = violations[0][0];
+  const auto end   = violations[0][1];
+  std::ostringstream oss;
+  oss << "The liveness cap of " << getLivenessCap()
+      << " cannot be met. The liveness exceeds it in " << violations.size()
+      << " range(s) of schedule indices. The first is [" << start << ", "
+      << end << "), where the liveness is as high as "
+      << schToLiveness.rangeMax(static_cast<uint64_t>(start),
+                                static_cast<uint64_t>(end))
+      << ". The Ops in this range are:";
+  for (auto i = start; i < std::min(end, start + maxOpsListed); ++i) {
+    oss << "\n  " << i << " : " << getDebugString(scheduleToOp(i));
+  }
+  if (end - start > maxOpsListed) {
+    oss << "\n  ...";
+  }
+  throw error(oss.str());
+}
+
+std::vector<OpAddress>
+Graph::kahn(const std::vector<uint64_t> &priorities) const {
+
+  std::vector<OpAddress> schedule;
+  schedule.reserve(nOps());
+
+  if (hasAtLeastOneLink()) {
+    auto merged                = getLinkMerged(false);
+    auto &childGraph           = std::get<0>(merged);
+    const auto &childToParents = std::get<1>(merged);
+    std::vector<uint64_t> childPriorities(
+        childGraph.nOps(), std::numeric_limits<uint64_t>::max());
+    for (OpAddress childAddress = 0; childAddress < childGraph.nOps();
+         ++childAddress) {
+      for (auto parentAddress : childToParents[childAddress]) {
+        childPriorities[childAddress] = std::min(
+            childPriorities[childAddress], priorities[parentAddress]);
+      }
+    }
+    for (auto childAddress : childGraph.kahn(childPriorities)) {
+      schedule.insert(schedule.end(),
+                      childToParents[childAddress].cbegin(),
+                      childToParents[childAddress].cend());
+    }
+    return schedule;
+  }
+
+  using PriorityAndOp = std::tuple<uint64_t, OpAddress>;
+  std::priority_queue<PriorityAndOp,
+                      std::vector<PriorityAndOp>,
+                      std::greater<PriorityAndOp>>
+      ready;
+
+  std::vector<uint64_t> outstanding;
+  outstanding.reserve(nOps());
+  for (const auto &op : getOps()) {
+    outstanding.push_back(op.nIns());
+    if (op.nIns() == 0) {
+      ready.push({priorities[op.getAddress()], op.getAddress()});
+    }
+  }
+
+  while (!ready.empty()) {
+    const auto address = std::get<1>(ready.top());
+    ready.pop();
+    schedule.push_back(address);
+    for (auto cAddress : getOp(address).getOuts()) {
+      --outstanding[cAddress];
+      if (outstanding[cAddress] == 0) {
+        ready.push({priorities[cAddress], cAddress});
+      }
+    }
+  }
+
+  if (schedule.size() != nOps()) {
+    std::ostringstream oss;
+    oss << "Failed to schedule Ops in Graph::kahn(priorities), only managed "
+        << "to schedule " << schedule.size() << " of " << nOps()
+        << ". Is there a cycle?";
+    throw error(oss.str());
+  }
+  return schedule;
 }
 
 void Graph::finalize() {
@@ -1064,7 +2187,8 @@ void Graph::finalize() {
   for (auto &alloc : allAllocs) {
     alloc.sortAndMakeUnique();
   }
-  isFinalized = true;
+  isFinalized            = true;
+  deferringDeduplication = false;
 }
 
 std::vector<std::vector<OpAddress>> Graph::getForwardEdges() const {
@@ -1143,15 +2267,21 @@ void Graph::finalizeTransitiveClosure() {
     removeConstraint(std::get<0>(x), std::get<1>(x));
   }
 
-  auto zero        = AllocWeight::zero();
-  lowerBoundChange = std::vector<AllocWeight>(nOps(), zero);
-  upperBoundChange = std::vector<AllocWeight>(nOps(), zero);
-
-  // initializing lowerBoundChange and upperBoundChange
   log().debug("Initializing lowerBoundChange and upperBoundChange.");
+  setBoundChanges(transitiveClosure, lowerBoundChange, upperBoundChange);
+}
+
+void Graph::setBoundChanges(
+    const transitiveclosure::TransitiveClosure &closure,
+    std::vector<AllocWeight> &lower,
+    std::vector<AllocWeight> &upper) const {
+
+  auto zero = AllocWeight::zero();
+  lower     = std::vector<AllocWeight>(nOps(), zero);
+  upper     = std::vector<AllocWeight>(nOps(), zero);
+
   for (const auto &alloc : getAllocs()) {
-    auto relativePositions =
-        transitiveClosure.getRelativePositions(alloc.getOps());
+    auto relativePositions = closure.getRelativePositions(alloc.getOps());
 
     // Logic check:
     if (relativePositions.size() != alloc.getOps().size()) {
@@ -1166,14 +2296,122 @@ void Graph::finalizeTransitiveClosure() {
 
     for (uint64_t opIndex = 0; opIndex < alloc.nOps(); ++opIndex) {
       auto opId = alloc.getOps()[opIndex];
-      updateFromFirstFinal(lowerBoundChange[opId],
-                           upperBoundChange[opId],
-                           alloc.getWeight(),
+      updateFromFirstFinal(lower[opId],
+                           upper[opId],
+                           getAllocWeight(alloc.getAddress()),
                            relativePositions[opIndex]);
     }
   }
 }
 
+AllocWeight Graph::getSumLivenessLowerBound() const {
+  // The TransitiveClosure of initialize is not built if all its
+  // optimizations are off, in which case the Graph may have been edited.
+  if (transitiveClosure.nOps_u64() == nOps() &&
+      lowerBoundChange.size() == nOps()) {
+    return getSumLivenessLowerBound(transitiveClosure, lowerBoundChange);
+  }
+  const transitiveclosure::TransitiveClosure closure(getForwardEdges());
+  std::vector<AllocWeight> lower;
+  std::vector<AllocWeight> upper;
+  setBoundChanges(closure, lower, upper);
+  return getSumLivenessLowerBound(closure, lower);
+}
+
+AllocWeight Graph::getSumLivenessLowerBound(
+    const transitiveclosure::TransitiveClosure &closure,
+    const std::vector<AllocWeight> &lowerChanges) const {
+
+  using transitiveclosure::BitSet;
+  using transitiveclosure::BitSetSize;
+
+  const auto nBitSetsPerOp = closure.getNBitSetsPerOp();
+  const auto &fwdEdgeSet   = closure.getFwdEdgeSet();
+  const auto &bwdEdgeSet   = closure.getBwdEdgeSet();
+
+  // Bound (1). An Alloc with a negative weight is live for at most the
+  // schedule indices between the earliest and latest of its Ops.
+  AllocWeight spanBound = AllocWeight::zero();
+  std::vector<BitSet> after(nBitSetsPerOp);
+  std::vector<BitSet> before(nBitSetsPerOp);
+  bool nonNegative{true};
+  for (const auto &alloc : getAllocs()) {
+    if (alloc.nOps() == 0) {
+      continue;
+    }
+    const auto w = getAllocWeight(alloc.getAddress());
+
+    uint64_t minEarliest = nOps();
+    uint64_t maxEarliest{0};
+    uint64_t minLatest = nOps();
+    uint64_t maxLatest{0};
+    for (auto opAddress : alloc.getOps()) {
+      const auto earliest = closure.earliest(opAddress);
+      const auto latest   = closure.latest(opAddress);
+      minEarliest         = std::min(minEarliest, earliest);
+      maxEarliest         = std::max(maxEarliest, earliest);
+      minLatest           = std::min(minLatest, latest);
+      maxLatest           = std::max(maxLatest, latest);
+    }
+
+    if (w < AllocWeight::zero()) {
+      nonNegative = false;
+      spanBound += static_cast<int64_t>(maxLatest - minEarliest + 1) * w;
+      continue;
+    }
+
+    // The Ops which are after one of the Alloc's Ops, and before another,
+    // in all schedules
+    for (uint64_t i = 0; i < nBitSetsPerOp; ++i) {
+      after[i].reset();
+      before[i].reset();
+    }
+    for (auto opAddress : alloc.getOps()) {
+      for (uint64_t i = 0; i < nBitSetsPerOp; ++i) {
+        after[i] |= bwdEdgeSet[opAddress * nBitSetsPerOp + i];
+        before[i] |= fwdEdgeSet[opAddress * nBitSetsPerOp + i];
+      }
+    }
+    uint64_t nLive{0};
+    for (uint64_t i = 0; i < nBitSetsPerOp; ++i) {
+      nLive += (after[i] & before[i]).count();
+    }
+    for (auto opAddress : alloc.getOps()) {
+      const auto i     = opAddress / BitSetSize;
+      const auto shift = opAddress % BitSetSize;
+      if (!(after[i][shift] && before[i][shift])) {
+        ++nLive;
+      }
+    }
+
+    if (maxEarliest > minLatest) {
+      nLive = std::max(nLive, maxEarliest - minLatest + 1);
+    }
+    spanBound += static_cast<int64_t>(nLive) * w;
+  }
+
+  if (!nonNegative) {
+    return spanBound;
+  }
+
+  // Bound (2). The sum liveness is the sum over Allocs of their weights,
+  // plus the sum over schedule indices i of (nOps - i) times the change in
+  // liveness at i, which is lowest with the lowest changes first.
+  AllocWeight changeBound = AllocWeight::zero();
+  for (const auto &alloc : getAllocs()) {
+    if (alloc.nOps() > 0) {
+      changeBound += getAllocWeight(alloc.getAddress());
+    }
+  }
+  auto sortedChanges = lowerChanges;
+  std::sort(sortedChanges.begin(), sortedChanges.end());
+  for (uint64_t i = 0; i < sortedChanges.size(); ++i) {
+    changeBound += static_cast<int64_t>(nOps() - i) * sortedChanges[i];
+  }
+
+  return std::max(spanBound, changeBound);
+}
+
 void Graph::initializeTransitiveClosure() {
   transitiveClosure = transitiveclosure::TransitiveClosure(getForwardEdges());
   finalizeTransitiveClosure();
@@ -1222,6 +2460,10 @@ bool Graph::linkCloseTightPairs() {
         if (neither.any()) {
           for (uint64_t shift = 0; shift < BitSetSize; ++shift) {
             auto id = i * BitSetSize + shift;
+            // The bits of the final BitSet beyond nOps() are not Ops
+            if (id == opId || id >= nOps() || !neither[shift]) {
+              continue;
+            }
 
             //      L     U
             //  ....xxxxxxx..  -- a
@@ -1230,8 +2472,7 @@ bool Graph::linkCloseTightPairs() {
             //  ==> intersection if L < u && l < U
             auto l = lowerBoundChange[id];
             auto u = upperBoundChange[id];
-            if (id != opId && id < nOps() && neither[shift] && L < u &&
-                l < U) {
+            if (L < u && l < U) {
               return false;
             }
           }
@@ -1386,7 +2627,7 @@ bool Graph::constrainParallelChains() {
           const auto &alloc = getAlloc(allocAddress);
           const auto &all   = alloc.getOps();
           auto relPoss      = transitiveClosure.getRelativePositions(all);
-          auto negW         = -1 * alloc.getWeight();
+          auto negW         = -1 * getAllocWeight(allocAddress);
 
           AllocWeight dummy = AllocWeight::zero();
           {
@@ -1495,6 +2736,8 @@ void Graph::applyTransitiveClosureOptimizations(
     return;
   }
 
+  isTransitiveClosureOptimized = true;
+
   bool wasChange{true};
   int iteration{0};
   const auto iterStr = "iteration = " + std::to_string(iteration);
@@ -1586,65 +2829,213 @@ void Graph::initialize(KahnTieBreaker kahnTie,
       << nAllocs() << " Allocs, " << nConstraints() << " constraints. ";
   log().trace(oss.str());
 
+  // A Graph initialized before is initialized again from scratch
+  isInitialized = false;
+  discardTransitiveClosure();
+
   if (!isFinalized) {
     finalize();
   }
 
+  if (hasLivenessCap()) {
+    assertSingleResourceClass();
+  }
+
   applyTransitiveClosureOptimizations(tco);
 
   //
   // schToOp. Vanilla run of Kahn's O(E) algorithm, random tie-breaks
-  kahn(kahnTie, kahnSeed);
+  setSchedule(kahn(kahnTie, kahnSeed));
+
+  isInitialized = true;
+}
+
+void Graph::initialize(const std::vector<OpAddress> &schedule) {
+
+  std::ostringstream oss;
+  oss << "Graph::initialize(schedule) entered for Graph with " << nOps()
+      << " Ops, " << nAllocs() << " Allocs, " << nConstraints()
+      << " constraints. ";
+  log().trace(oss.str());
+
+  // A Graph initialized before is initialized again from scratch
+  isInitialized = false;
+  discardTransitiveClosure();
+
+  if (!isFinalized) {
+    finalize();
+  }
+
+  if (hasLivenessCap()) {
+    assertSingleResourceClass();
+  }
+
+  assertValidSchedule(schedule);
+  setSchedule(std::vector<OpAddress>(schedule));
+
+  isInitialized = true;
+}
+
+void Graph::updateSchedule(
+    const std::map<std::string, std::string> &annealOptions) {
+
+  if (!isInitialized) {
+    throw error("updateSchedule should only be called after initialize(.,.)");
+  }
+
+  if (annealOptions.count("filterSusceptible") != 0) {
+    throw error("filterSusceptible cannot be set in updateSchedule, as "
+                "localized annealing requires it to be true");
+  }
+
+  finalize();
+
+  // Ops which are already in the schedule are prioritized by their current
+  // schedule index, new Ops are prioritized above all of them.
+  const auto nOld = static_cast<uint64_t>(schToOp.size());
+  const auto nNew = nOps() - nOld;
+  std::vector<uint64_t> priorities(nOps());
+  for (OpAddress a = 0; a < nOps(); ++a) {
+    priorities[a] = a < nOld ? nNew + static_cast<uint64_t>(opToSch[a])
+                             : a - nOld;
+  }
+  auto spliced = kahn(priorities);
+
+  // The region to anneal: edited Ops and their neighbours, and Ops whose
+  // order relative to the other Ops of the previous schedule has changed.
+  std::vector<bool> region(nOps(), false);
+  for (auto a : editedOps) {
+    region[a] = true;
+    for (auto inAddress : getOp(a).getIns()) {
+      region[inAddress] = true;
+    }
+    for (auto outAddress : getOp(a).getOuts()) {
+      region[outAddress] = true;
+    }
+  }
+  uint64_t oldIndex{0};
+  for (auto a : spliced) {
+    if (a < nOld) {
+      if (a != schToOp[oldIndex]) {
+        region[a] = true;
+      }
+      ++oldIndex;
+    }
+  }
+
+  std::ostringstream oss;
+  oss << "Updating schedule with " << nNew << " new Ops, "
+      << std::count(region.cbegin(), region.cend(), true)
+      << " Ops in the region to re-anneal.";
+  log().debug(oss.str());
+
+  setSchedule(std::move(spliced));
+
+  annealRegion = std::move(region);
+  try {
+    minSumLivenessAnneal(annealOptions);
+  } catch (...) {
+    annealRegion.clear();
+    throw;
+  }
+  annealRegion.clear();
+}
+
+void Graph::assertValidSchedule(
+    const std::vector<OpAddress> &schedule) const {
+
+  if (schedule.size() != nOps()) {
+    std::ostringstream oss;
+    oss << "Invalid schedule of size " << schedule.size()
+        << " for Graph with " << nOps() << " Ops.";
+    throw error(oss.str());
+  }
+
+  const auto unscheduled = std::numeric_limits<ScheduleIndex>::max();
+  std::vector<ScheduleIndex> opToIndex(nOps(), unscheduled);
+  for (ScheduleIndex i = 0; i < nOps_i32(); ++i) {
+    const auto opAddress = schedule[static_cast<uint64_t>(i)];
+    if (opAddress >= nOps() || opToIndex[opAddress] != unscheduled) {
+      std::ostringstream oss;
+      oss << "Invalid schedule, the OpAddress " << opAddress
+          << " at schedule index " << i
+          << " is either not in the Graph, or appears more than once.";
+      throw error(oss.str());
+    }
+    opToIndex[opAddress] = i;
+  }
+
+  for (const auto &op : getOps()) {
+    for (auto outAddress : op.getOuts()) {
+      if (opToIndex[outAddress] < opToIndex[op.getAddress()]) {
+        std::ostringstream oss;
+        oss << "Invalid schedule, the constraint " << op.getAddress()
+            << " -> " << outAddress << " is not satisfied.";
+        throw error(oss.str());
+      }
+    }
+    if (op.hasForwardLink() && opToIndex[op.getForwardLink()] !=
+                                   opToIndex[op.getAddress()] + 1) {
+      std::ostringstream oss;
+      oss << "Invalid schedule, the link " << op.getAddress() << " -> "
+          << op.getForwardLink() << " is not satisfied.";
+      throw error(oss.str());
+    }
+  }
+}
+
+void Graph::setSchedule(std::vector<OpAddress> &&schedule) {
+
+  schToOp = std::move(schedule);
+  editedOps.clear();
 
   //
   // opToSch
-  opToSch.reserve(nOps());
-  opToSch.clear();
+  opToSch.resize(nOps());
 
   for (ScheduleIndex i = 0; i < nOps(); ++i) {
     opToSch[scheduleToOp(i)] = i;
   }
 
+  uint64_t nAllocEntries{0};
+  uint64_t nEdges{0};
+  for (const auto &op : getOps()) {
+    nAllocEntries += op.nAllocs();
+    nEdges += op.nOuts();
+  }
+
   //
   // allocToSch
-  allocToSch.resize(nAllocs());
   allocToSch.clear();
-
+  allocToSch.reserve(nAllocs(), nAllocEntries);
   for (AllocAddress allocAddress = 0; allocAddress < nAllocs();
        ++allocAddress) {
+    allocToSch.appendRow(getAlloc(allocAddress).nOps());
     setAllocToSch(allocAddress);
   }
 
   //
   // schToAllocs
-  schToAllocs.reserve(nOps());
   schToAllocs.clear();
-
+  schToAllocs.reserve(nOps(), nAllocEntries);
   for (ScheduleIndex schedIndex = 0; schedIndex < nOps(); ++schedIndex) {
-    auto schedIndex_u64 = static_cast<uint64_t>(schedIndex);
-    auto opAddress      = scheduleToOp(schedIndex);
-    const auto &op      = getOp(opAddress);
-    schToAllocs.push_back({});
-    schToAllocs[schedIndex_u64].reserve(op.nAllocs());
-    for (AllocAddress allocAddress : op.getAllocs()) {
-      schToAllocs[schedIndex_u64].push_back(allocAddress);
-    }
-    std::sort(schToAllocs[schedIndex_u64].begin(),
-              schToAllocs[schedIndex_u64].end());
+    const auto &allocs = getOp(scheduleToOp(schedIndex)).getAllocs();
+    schToAllocs.appendRow(allocs.cbegin(), allocs.cend());
+    auto row = schToAllocs.row(static_cast<uint64_t>(schedIndex));
+    std::sort(row.begin(), row.end());
   }
 
   //
-  // opToInSch
-  opToInSch.resize(nOps());
+  // opToInSch, opToOutSch
+  opToInSch.clear();
+  opToOutSch.clear();
+  opToInSch.reserve(nOps(), nEdges);
+  opToOutSch.reserve(nOps(), nEdges);
   for (OpAddress opAddress = 0; opAddress < nOps(); ++opAddress) {
+    opToInSch.appendRow(getOp(opAddress).nIns());
     setOpToInSch(opAddress);
-  }
-
-  //
-  // opToOutSch
-  opToOutSch.resize(nOps());
-  for (OpAddress opAddress = 0; opAddress < nOps(); ++opAddress) {
-    setOpToOutSch(opAddress);
+    opToOutSch.appendRow(getOp(opAddress).nOuts());
+    setOpToOutSch(opAddress);
   }
 
   //
@@ -1654,12 +3045,19 @@ void Graph::initialize(KahnTieBreaker kahnTie,
   //
   // nFwd, nBwd
   setCanCan(1);
+}
 
-  rippleScratch.resize(
-      nAllocs(),
-      {-1, AllocWeight::negativeOne(), AllocWeight::negativeOne(), false});
-
-  isInitialized = true;
+template <typename W>
+Graph::RippleScratch<W> Graph::getInitialRippleScratch() const {
+  RippleScratch<W> scratch;
+  scratch.entries.resize(nAllocs(), {-1, W(-1), W(-1), false});
+  scratch.liveAllocs.reserve(nAllocs());
+  scratch.costs.reserve(nOps());
+  scratch.shifts.reserve(nOps());
+  scratch.changes.reserve(nAllocs());
+  scratch.events.reserve(4 * nAllocs());
+  scratch.allocs.setUniverseSize(nAllocs());
+  return scratch;
 }
 
 void Graph::setCanCan(int nToShift) {
@@ -1731,7 +3129,7 @@ std::vector<AllocWeight> Graph::getDeltaLiveness() const {
   for (AllocAddress allocAddress = 0; allocAddress < nAllocs();
        ++allocAddress) {
     if (getAlloc(allocAddress).nOps() > 0) {
-      auto w = getAlloc(allocAddress).getWeight();
+      auto w = getAllocWeight(allocAddress);
       auto firstSched =
           static_cast<uint64_t>(allocToFirstSchedule(allocAddress));
       auto finalSched =
@@ -1807,6 +3205,28 @@ void Graph::assertCorrectness() const {
       }
     }
   }
+
+  // liveness, which is updated incrementally
+  auto isClose = [](const AllocWeight &a, const AllocWeight &b) {
+    const auto relErr = absolute(a - b) / (1.0 + absolute(b));
+    const auto errs   = relErr.get();
+    return std::all_of(
+        errs.cbegin(), errs.cend(), [](double x) { return x <= 1e-5; });
+  };
+  const auto liveness = getPartialSums(getDeltaLiveness());
+  for (uint64_t i = 0; i < liveness.size(); ++i) {
+    if (!isClose(schToLiveness.at(i), liveness[i])) {
+      std::ostringstream oss;
+      oss << "Liveness is incorrect at schedule index " << i << ", it is "
+          << schToLiveness.at(i) << " but should be " << liveness[i] << '.';
+      throw error(oss.str());
+    }
+  }
+  if (!isClose(sumLiveness,
+               std::accumulate(
+                   liveness.cbegin(), liveness.cend(), AllocWeight(0)))) {
+    throw error("Sum liveness is incorrect, failure in assertCorrectness");
+  }
 }
 
 ShiftAndCost Graph::getBestShiftSimpleAlgo(const ScheduleIndex start0,
@@ -1824,7 +3244,8 @@ ShiftAndCost Graph::getBestShiftSimpleAlgo(const ScheduleIndex start0,
           i0           = std::min(i0, opIndex);
           i1           = std::max(i1, opIndex);
         }
-        auto totAlloc = (i1 - i0 + 1) * alloc.getWeight();
+        auto totAlloc =
+            (i1 - i0 + 1) * getAllocWeight(alloc.getAddress());
         tot += totAlloc;
       }
     }
@@ -1962,35 +3383,874 @@ void Graph::confirmShiftAndCost(ScheduleIndex start0,
   }
 }
 
+namespace {
+
+// Metropolis acceptance of a shift which changes sum liveness by "cost", at
+// temperature T, where u is uniformly distributed in [0, 1).
+bool acceptMetropolis(const AllocWeight &cost, double T, double u) {
+  if (cost < AllocWeight::zero()) {
+    return true;
+  }
+  const auto lanes = cost.get();
+  for (uint64_t i = 0; i < (NAW - 1) / 2; ++i) {
+    if (lanes[i] != 0.) {
+      return false;
+    }
+  }
+  return u < std::exp(-std::max(0.0, cost.getCentre()) / T);
+}
+
+bool isCancelled(const AnnealOptions &options) {
+  return options.cancel != nullptr && options.cancel->load();
+}
+
+} // namespace
+
+template <typename W>
+void Graph::temperatureAnneal(const AnnealOptions &options,
+                              AllocWeight &totalDeltaSumLiveness,
+                              int64_t &nChangesInTotal,
+                              uint64_t &nUphillAcceptedInTotal) {
+
+  const auto initialTemperature = options.initialTemperature;
+  const auto coolingRate        = options.coolingRate;
+  const auto nTemperatureSteps  = options.nTemperatureSteps;
+
+  // Ops are shifted individually during the temperature phase, larger
+  // blocks are considered in the T=0 phase which follows.
+  constexpr int nToShift{1};
+
+  // below this fraction of accepted liveness increasing shifts, a level is
+  // considered frozen
+  constexpr double frozenAcceptanceRatio{0.02};
+
+  std::mt19937 g(options.seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  auto scratch = getInitialRippleScratch<W>();
+
+  std::vector<OpAddress> allOpAddresses(nOps());
+  std::iota(allOpAddresses.begin(), allOpAddresses.end(), 0UL);
+
+  const auto startTime = std::chrono::high_resolution_clock::now();
+
+  // the change in sum liveness relative to the start of this phase, and the
+  // lowest value it has taken
+  AllocWeight currentDelta = AllocWeight::zero();
+  AllocWeight bestDelta    = AllocWeight::zero();
+
+  double temperature       = initialTemperature;
+  double reheatTemperature = initialTemperature;
+  int64_t nChanges{0};
+
+  // This phase uses at most half of the time and swap limits, which are
+  // checked after every shift, so that a level of a large Graph does not
+  // overshoot them
+  auto withinLimits = [&options, &startTime, &nChanges]() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    return elapsed.count() <= 0.5 * options.timeLimitSeconds &&
+           nChanges < options.swapLimitCount / 2 && !isCancelled(options);
+  };
+
+  for (uint32_t level = 0; level < nTemperatureSteps; ++level) {
+
+    std::shuffle(allOpAddresses.begin(), allOpAddresses.end(), g);
+
+    uint64_t nUphillProposed{0};
+    uint64_t nUphillAccepted{0};
+    bool improvedBest{false};
+
+    for (auto opAddress : allOpAddresses) {
+      if (!withinLimits()) {
+        break;
+      }
+      const auto start0 = opToSchedule(opAddress);
+      const auto &op0   = getOp(opAddress);
+      if (op0.hasBackwardLink() || op0.hasForwardLink()) {
+        continue;
+      }
+
+      const auto &shifts = getAllShiftsRippleAlgo(start0, nToShift, scratch);
+      if (shifts.empty()) {
+        continue;
+      }
+
+      std::uniform_int_distribution<uint64_t> pick(0, shifts.size() - 1);
+      const auto &proposal = shifts[pick(g)];
+      const auto cost      = proposal.getCost();
+      const bool uphill    = AllocWeight::zero() < cost;
+      if (uphill) {
+        ++nUphillProposed;
+      }
+      if (!acceptMetropolis(cost, temperature, uniform(g)) ||
+          exceedsLivenessCap({start0, start0 + proposal.getShift(), nToShift},
+                             scratch)) {
+        continue;
+      }
+      if (uphill) {
+        ++nUphillAccepted;
+      }
+
+      applyChange({start0, start0 + proposal.getShift(), nToShift});
+      if (options.debug) {
+        assertCorrectness();
+      }
+
+      ++nChanges;
+      totalDeltaSumLiveness += cost;
+      currentDelta += cost;
+      if (currentDelta < bestDelta) {
+        bestDelta    = currentDelta;
+        improvedBest = true;
+      }
+    }
+
+    std::ostringstream oss;
+    oss << "Temperature level " << level << ", T = " << temperature
+        << ", accepted " << nUphillAccepted << " of " << nUphillProposed
+        << " liveness increasing shifts";
+    log().info(oss.str());
+    nUphillAcceptedInTotal += nUphillAccepted;
+
+    switch (options.coolingSchedule) {
+    case CoolingSchedule::GEOMETRIC: {
+      temperature *= coolingRate;
+      break;
+    }
+    case CoolingSchedule::LINEAR: {
+      temperature =
+          initialTemperature *
+          (1.0 - static_cast<double>(level + 1) / nTemperatureSteps);
+      break;
+    }
+    case CoolingSchedule::ADAPTIVEREHEAT: {
+      const bool frozen = static_cast<double>(nUphillAccepted) <=
+                          frozenAcceptanceRatio * nUphillProposed;
+      if (frozen && !improvedBest) {
+        reheatTemperature *= 0.5;
+        temperature = reheatTemperature;
+        log().info("Frozen without improvement, reheating");
+      } else {
+        temperature *= coolingRate;
+      }
+      break;
+    }
+    default: {
+      throw error("Unrecognised CoolingSchedule");
+    }
+    }
+
+    if (!withinLimits() || temperature <= 0.0) {
+      break;
+    }
+  }
+
+  nChangesInTotal += nChanges;
+}
+
+template <typename W>
+void Graph::tabuSearch(const AnnealOptions &options,
+                       double timeLimitSeconds,
+                       int64_t swapLimitCount,
+                       AllocWeight &totalDeltaSumLiveness,
+                       int64_t &nChangesInTotal) {
+
+  // As in the temperature phase, Ops are shifted individually
+  constexpr int nToShift{1};
+
+  std::mt19937 g(options.seed);
+  auto scratch = getInitialRippleScratch<W>();
+
+  std::vector<OpAddress> allOpAddresses(nOps());
+  std::iota(allOpAddresses.begin(), allOpAddresses.end(), 0UL);
+
+  const auto startTime = std::chrono::high_resolution_clock::now();
+  int64_t nChanges{0};
+  auto withinLimits = [&options,
+                       &startTime,
+                       &nChanges,
+                       timeLimitSeconds,
+                       swapLimitCount]() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    return elapsed.count() < timeLimitSeconds &&
+           nChanges < swapLimitCount && !isCancelled(options);
+  };
+
+  // The change in sum liveness relative to the start of this phase, and
+  // that of the best schedule seen
+  AllocWeight currentDelta = AllocWeight::zero();
+  AllocWeight bestDelta    = AllocWeight::zero();
+  auto bestSchedule        = getScheduleToOp();
+
+  // The Op at opAddress is tabu in iteration i if i < tabuUntil[opAddress]
+  std::vector<uint64_t> tabuUntil(nOps(), 0);
+
+  auto isShiftable = [this](OpAddress opAddress) {
+    const auto &op = getOp(opAddress);
+    return !op.hasBackwardLink() && !op.hasForwardLink();
+  };
+
+  // A tabu Op may be shifted if the result is better than the best seen
+  auto isAllowed = [&tabuUntil, &currentDelta, &bestDelta](
+                       uint64_t iteration,
+                       OpAddress opAddress,
+                       const AllocWeight &cost) {
+    return iteration >= tabuUntil[opAddress] ||
+           currentDelta + cost < bestDelta;
+  };
+
+  auto apply = [this, &options, &nChanges, &currentDelta](
+                   OpAddress opAddress, const ShiftAndCost &shift) {
+    const auto start0 = opToSchedule(opAddress);
+    applyChange({start0, start0 + shift.getShift(), nToShift});
+    if (options.debug) {
+      assertCorrectness();
+    }
+    ++nChanges;
+    currentDelta += shift.getCost();
+  };
+
+  uint64_t iteration{0};
+  for (; iteration < options.nTabuIterations && withinLimits();
+       ++iteration) {
+
+    // Escape: the allowed 1-shift with the lowest cost, whether or not it
+    // reduces liveness. Ties are broken by the shuffled order of the Ops.
+    std::shuffle(allOpAddresses.begin(), allOpAddresses.end(), g);
+    OpAddress escapeOp{0};
+    ShiftAndCost escape{0, AllocWeight::zero()};
+    bool foundEscape{false};
+    for (auto opAddress : allOpAddresses) {
+      if (!isShiftable(opAddress)) {
+        continue;
+      }
+      for (const auto &shift : getAllShiftsRippleAlgo(
+               opToSchedule(opAddress), nToShift, scratch)) {
+        const auto start0 = opToSchedule(opAddress);
+        if (shift.getCost() != AllocWeight::zero() &&
+            (!foundEscape || shift.getCost() < escape.getCost()) &&
+            isAllowed(iteration, opAddress, shift.getCost()) &&
+            !exceedsLivenessCap({start0, start0 + shift.getShift(), nToShift},
+                                scratch)) {
+          foundEscape = true;
+          escapeOp    = opAddress;
+          escape      = shift;
+        }
+      }
+    }
+    if (!foundEscape) {
+      break;
+    }
+    apply(escapeOp, escape);
+    tabuUntil[escapeOp] = iteration + 1 + options.tabuTenure;
+
+    // Descend: apply allowed improving 1-shifts until there are none
+    bool improved{true};
+    while (improved && withinLimits()) {
+      improved = false;
+      std::shuffle(allOpAddresses.begin(), allOpAddresses.end(), g);
+      for (auto opAddress : allOpAddresses) {
+        if (!isShiftable(opAddress)) {
+          continue;
+        }
+        const auto start0 = opToSchedule(opAddress);
+        const auto shift =
+            hasLivenessCap()
+                ? getBestShiftCappedAlgo(start0, nToShift, scratch)
+                : getBestShiftRippleAlgo(start0, nToShift, scratch);
+        if (shift.getCost() < AllocWeight::zero() &&
+            isAllowed(iteration, opAddress, shift.getCost())) {
+          apply(opAddress, shift);
+          improved = true;
+        }
+      }
+    }
+
+    if (currentDelta < bestDelta) {
+      bestDelta    = currentDelta;
+      bestSchedule = getScheduleToOp();
+    }
+
+    if (log().shouldLogInfo()) {
+      std::ostringstream oss;
+      oss << "Tabu iteration " << iteration << ", change in sum liveness = "
+          << currentDelta << ", best = " << bestDelta;
+      log().info(oss.str());
+    }
+  }
+
+  // Install the best schedule seen, if it is not the current one
+  if (bestDelta < currentDelta) {
+    setSchedule(std::move(bestSchedule));
+  }
+
+  totalDeltaSumLiveness += bestDelta;
+  nChangesInTotal += nChanges;
+}
+
+namespace {
+
+// Finds the order of the Ops at the schedule indices [start, end) which
+// minimizes the sum liveness. The Ops outside the window do not move, and
+// so the liveness outside the window does not change, and an Alloc's Ops
+// outside the window only matter through whether it has any Op before the
+// window, and any Op after it. An Alloc is live at a schedule index in the
+// window if it has an Op at or before it, and an Op at or after it. With a
+// liveness cap, no order may raise the liveness in the window above both the
+// cap and its current maximum in the window.
+class WindowSolver {
+public:
+  explicit WindowSolver(const Graph &g)
+      : graph(g), allocs(g.nAllocs()), allocIndices(g.nAllocs()) {}
+
+  // Returns true if there is an order of the Ops in [start, end) with lower
+  // sum liveness than the current one. If there is, the best order is
+  // getOrder(), and getCost() is its change in sum liveness.
+  bool solve(ScheduleIndex start, ScheduleIndex end);
+
+  const std::vector<OpAddress> &getOrder() const { return order; }
+  const AllocWeight &getCost() const { return cost; }
+
+private:
+  using Subset = uint32_t;
+
+  struct WindowAlloc {
+    // The Ops of the Alloc in the window
+    Subset ops;
+    bool before;
+    bool after;
+    AllocWeight weight;
+  };
+
+  // The liveness at the schedule index of the window's Op k, when the Ops
+  // in placed are scheduled before it
+  AllocWeight getLiveness(Subset placed, uint64_t k) const {
+    const Subset upToK = placed | (Subset(1) << k);
+    const Subset fromK = ~placed;
+    auto liveness      = AllocWeight::zero();
+    for (const auto &alloc : windowAllocs) {
+      if ((alloc.before || (alloc.ops & upToK) != 0) &&
+          (alloc.after || (alloc.ops & fromK) != 0)) {
+        liveness += alloc.weight;
+      }
+    }
+    return liveness;
+  }
+
+  const Graph &graph;
+  util::EpochSet allocs;
+  std::vector<uint64_t> allocIndices;
+  std::vector<WindowAlloc> windowAllocs;
+
+  // The Ops in the window, in their current order
+  std::vector<OpAddress> ops;
+  // The Ops in the window which must be before each Op in the window
+  std::vector<Subset> predecessors;
+
+  // For each subset of the window's Ops which can be scheduled first: the
+  // lowest sum liveness over the schedule indices they occupy, and the Op
+  // which is last in the order which attains it
+  std::vector<AllocWeight> best;
+  std::vector<uint8_t> reached;
+  std::vector<uint8_t> last;
+
+  std::vector<OpAddress> order;
+  AllocWeight cost{0};
+};
+
+bool WindowSolver::solve(ScheduleIndex start, ScheduleIndex end) {
+
+  const auto n = static_cast<uint64_t>(end - start);
+
+  ops.clear();
+  for (auto i = start; i < end; ++i) {
+    const auto opAddress = graph.scheduleToOp(i);
+    if (graph.getOp(opAddress).hasLink()) {
+      return false;
+    }
+    ops.push_back(opAddress);
+  }
+
+  // Constraints from Ops before the window are satisfied by any order, and
+  // there are none from Ops after the window
+  predecessors.assign(n, 0);
+  for (uint64_t k = 0; k < n; ++k) {
+    for (auto inAddress : graph.getOp(ops[k]).getIns()) {
+      const auto inSchedule = graph.opToSchedule(inAddress);
+      if (inSchedule >= start) {
+        predecessors[k] |= Subset(1) << (inSchedule - start);
+      }
+    }
+  }
+
+  allocs.clear();
+  windowAllocs.clear();
+  for (uint64_t k = 0; k < n; ++k) {
+    for (auto allocAddress : graph.getOp(ops[k]).getAllocs()) {
+      if (allocs.insert(allocAddress)) {
+        allocIndices[allocAddress] = windowAllocs.size();
+        windowAllocs.push_back(
+            {0,
+             graph.allocToFirstSchedule(allocAddress) < start,
+             graph.allocToFinalSchedule(allocAddress) >= end,
+             graph.getAllocWeight(allocAddress)});
+      }
+      windowAllocs[allocIndices[allocAddress]].ops |= Subset(1) << k;
+    }
+  }
+
+  auto current = AllocWeight::zero();
+  for (uint64_t k = 0; k < n; ++k) {
+    current += getLiveness((Subset(1) << k) - 1, k);
+  }
+
+  // The Allocs with no Op in the window are live at all or none of its
+  // schedule indices, and so add the same liveness to every order. The
+  // bound on the liveness of an order is the larger of the cap and the
+  // current maximum in the window.
+  const auto spanning = graph.hasLivenessCap()
+                            ? graph.scheduleToLiveness(start) -
+                                  getLiveness(0, 0)
+                            : AllocWeight::zero();
+  auto bound = graph.getLivenessCap();
+  if (graph.hasLivenessCap()) {
+    for (auto i = start; i < end; ++i) {
+      bound = std::max(bound, graph.scheduleToLiveness(i));
+    }
+  }
+
+  const Subset all = (Subset(1) << n) - 1;
+  if (best.size() <= all) {
+    best.resize(all + 1, AllocWeight::zero());
+    last.resize(all + 1, 0);
+  }
+  reached.assign(all + 1, 0);
+  best[0]    = AllocWeight::zero();
+  reached[0] = 1;
+
+  // Every subset is larger than the subsets it is reached from
+  for (Subset placed = 0; placed < all; ++placed) {
+    if (reached[placed] == 0) {
+      continue;
+    }
+    for (uint64_t k = 0; k < n; ++k) {
+      const Subset withK = placed | (Subset(1) << k);
+      if (withK == placed || (predecessors[k] & ~placed) != 0) {
+        continue;
+      }
+      const auto liveness = getLiveness(placed, k);
+      if (graph.hasLivenessCap() && bound < spanning + liveness) {
+        continue;
+      }
+      const auto candidate = best[placed] + liveness;
+      if (reached[withK] == 0 || candidate < best[withK]) {
+        best[withK]    = candidate;
+        last[withK]    = static_cast<uint8_t>(k);
+        reached[withK] = 1;
+      }
+    }
+  }
+
+  if (!(best[all] < current)) {
+    return false;
+  }
+
+  order.resize(n);
+  Subset placed = all;
+  for (uint64_t i = n; i > 0; --i) {
+    const auto k = last[placed];
+    order[i - 1] = ops[k];
+    placed &= ~(Subset(1) << k);
+  }
+  cost = best[all] - current;
+  return true;
+}
+
+} // namespace
+
+void Graph::windowSearch(const AnnealOptions &options,
+                         double timeLimitSeconds,
+                         int64_t swapLimitCount,
+                         AllocWeight &totalDeltaSumLiveness,
+                         int64_t &nChangesInTotal) {
+
+  const auto windowSize = static_cast<ScheduleIndex>(options.windowSize);
+
+  const auto startTime = std::chrono::high_resolution_clock::now();
+  int64_t nChanges{0};
+  auto withinLimits = [&options,
+                       &startTime,
+                       &nChanges,
+                       timeLimitSeconds,
+                       swapLimitCount]() {
+    std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startTime;
+    return elapsed.count() < timeLimitSeconds &&
+           nChanges < swapLimitCount && !isCancelled(options);
+  };
+
+  // One solver per thread. Windows are disjoint, and a window's best order
+  // does not depend on the order of the Ops in other windows, so all the
+  // windows of a sweep are solved before any is applied.
+  const auto nThreads = static_cast<uint64_t>(options.nThreads);
+  util::ThreadPool threadPool(nThreads);
+  std::vector<WindowSolver> solvers(nThreads, WindowSolver(*this));
+
+  std::vector<ScheduleIndex> starts;
+  std::vector<uint8_t> improved;
+  std::vector<std::vector<OpAddress>> orders;
+  std::vector<AllocWeight> costs;
+
+  uint64_t nSweepsWithoutChange{0};
+  for (uint64_t sweep = 0; nSweepsWithoutChange < 2 && withinLimits();
+       ++sweep) {
+
+    const ScheduleIndex offset = sweep % 2 == 0 ? 0 : windowSize / 2;
+    starts.clear();
+    for (auto start = offset; start + 1 < nOps_i32(); start += windowSize) {
+      starts.push_back(start);
+    }
+    improved.assign(starts.size(), 0);
+    orders.resize(starts.size());
+    costs.resize(starts.size(), AllocWeight::zero());
+
+    auto solveWindow = [this,
+                        &options,
+                        &solvers,
+                        &starts,
+                        &improved,
+                        &orders,
+                        &costs,
+                        windowSize](uint64_t window, uint64_t thread) {
+      if (isCancelled(options)) {
+        return false;
+      }
+      auto &solver   = solvers[thread];
+      const auto end = std::min(starts[window] + windowSize, nOps_i32());
+      if (solver.solve(starts[window], end)) {
+        improved[window] = 1;
+        orders[window]   = solver.getOrder();
+        costs[window]    = solver.getCost();
+      }
+      return true;
+    };
+    threadPool.forEach(starts.size(), solveWindow);
+
+    // Each Op is moved to its position in the window with a 1-shift
+    // towards the start of the window. All the Ops it moves past are later
+    // in the new order, so every intermediate schedule is valid.
+    uint64_t nImproved{0};
+    for (uint64_t window = 0; window < starts.size(); ++window) {
+      if (improved[window] == 0) {
+        continue;
+      }
+      const auto &order = orders[window];
+      for (uint64_t i = 0; i < order.size(); ++i) {
+        const auto start0 = opToSchedule(order[i]);
+        const auto start1 = starts[window] + static_cast<ScheduleIndex>(i);
+        if (start0 != start1) {
+          applyChange({start0, start1, 1});
+          if (options.debug) {
+            assertCorrectness();
+          }
+          ++nChanges;
+        }
+      }
+      totalDeltaSumLiveness += costs[window];
+      ++nImproved;
+    }
+
+    nSweepsWithoutChange = nImproved == 0 ? nSweepsWithoutChange + 1 : 0;
+
+    if (log().shouldLogInfo()) {
+      std::ostringstream oss;
+      oss << "Window sweep " << sweep << ", " << nImproved << " of "
+          << starts.size() << " windows improved";
+      log().info(oss.str());
+    }
+  }
+
+  nChangesInTotal += nChanges;
+}
+
 void Graph::minSumLivenessAnneal(
     const std::map<std::string, std::string> &m) {
-  bool debug              = defaultDebug();
-  uint32_t seed           = defaultMinSumLivenessSeed();
-  bool filterSusceptible  = defaultFilterSusceptible();
-  double timeLimitSeconds = defaultTimeLimitSeconds();
-  int64_t swapLimitCount  = defaultSwapLimitCount();
-
+  AnnealOptions options;
   for (const auto &[k, v] : m) {
     if (k == "debug") {
-      debug = static_cast<bool>(std::stoi(v));
+      options.debug = static_cast<bool>(std::stoi(v));
     } else if (k == "seed") {
-      seed = static_cast<uint32_t>(std::stoul(v));
+      options.seed = static_cast<uint32_t>(std::stoul(v));
     } else if (k == "timeLimitSeconds") {
-      timeLimitSeconds = static_cast<double>(std::stod(v));
+      options.timeLimitSeconds = static_cast<double>(std::stod(v));
     } else if (k == "swapLimitCount") {
-      swapLimitCount = static_cast<int64_t>(std::stoll(v));
+      options.swapLimitCount = static_cast<int64_t>(std::stoll(v));
     } else if (k == "filterSusceptible") {
-      filterSusceptible = static_cast<bool>(std::stoi(v));
+      options.filterSusceptible = static_cast<bool>(std::stoi(v));
+    } else if (k == "nThreads") {
+      options.nThreads = static_cast<uint32_t>(std::stoul(v));
+    } else if (k == "initialTemperature") {
+      options.initialTemperature = std::stod(v);
+    } else if (k == "coolingSchedule") {
+      options.coolingSchedule = coolingSchedule(v);
+    } else if (k == "nTemperatureSteps") {
+      options.nTemperatureSteps = static_cast<uint32_t>(std::stoul(v));
+    } else if (k == "coolingRate") {
+      options.coolingRate = std::stod(v);
+    } else if (k == "objective") {
+      options.objective = livenessObjective(v);
+    } else if (k == "maxWeight") {
+      options.maxWeight = std::stod(v);
+    } else if (k == "nTabuIterations") {
+      options.nTabuIterations = static_cast<uint64_t>(std::stoull(v));
+    } else if (k == "tabuTenure") {
+      options.tabuTenure = static_cast<uint32_t>(std::stoul(v));
+    } else if (k == "targetGapPercent") {
+      options.targetGapPercent = std::stod(v);
+    } else if (k == "windowSize") {
+      options.windowSize = static_cast<uint64_t>(std::stoull(v));
     } else {
       throw error("invalid option in minSumLivenessAnneal, " + k);
     }
   }
-  minSumLivenessAnneal(MinSumLivenessAlgo::RIPPLE,
-                       debug,
-                       seed,
-                       filterSusceptible,
-                       timeLimitSeconds,
-                       swapLimitCount);
+  minSumLivenessAnneal(options);
+}
+
+void Graph::minSumLivenessAnnealPortfolio(
+    uint64_t nStarts,
+    uint32_t nThreads,
+    uint32_t seed,
+    double timeLimitSeconds,
+    const std::map<std::string, std::string> &annealOptions) {
+
+  if (!isInitialized) {
+    throw error("minSumLivenessAnnealPortfolio should only be called after "
+                "initialize(.,.)");
+  }
+
+  if (nStarts == 0) {
+    throw error("nStarts must be positive in minSumLivenessAnnealPortfolio");
+  }
+
+  if (hasPendingEdits()) {
+    throw error("The Graph has been edited since it was initialized, "
+                "updateSchedule must be called before "
+                "minSumLivenessAnnealPortfolio");
+  }
+
+  for (auto reserved : {"seed", "timeLimitSeconds", "nThreads"}) {
+    if (annealOptions.count(reserved) != 0) {
+      std::ostringstream oss;
+      oss << "The option " << reserved << " is set by "
+          << "minSumLivenessAnnealPortfolio, and so cannot appear in "
+          << "annealOptions.";
+      throw error(oss.str());
+    }
+  }
+
+  // only the schedule and its sum liveness are retained from each start
+  std::vector<std::vector<OpAddress>> schedules(nStarts);
+  std::vector<AllocWeight> sumLivenesses(nStarts,
+                                         AllocWeight::numericMaxLimit());
+
+  const auto startPortfolio = std::chrono::high_resolution_clock::now();
+
+  util::ThreadPool threadPool(
+      std::min<uint64_t>(static_cast<uint64_t>(nThreads), nStarts));
+  threadPool.forEach(nStarts, [&](uint64_t start, uint64_t) {
+    std::chrono::duration<double> elapsed =
+        std::chrono::high_resolution_clock::now() - startPortfolio;
+    const auto remaining = timeLimitSeconds - elapsed.count();
+    if (start != 0 && remaining <= 0.0) {
+      return true;
+    }
+
+    const auto startSeed = seed + static_cast<uint32_t>(start);
+    auto g               = *this;
+    g.initialize(static_cast<KahnTieBreaker>(start % NKahnTieBreakers),
+                 startSeed,
+                 TransitiveClosureOptimizations::allOff());
+
+    auto options                = annealOptions;
+    options["seed"]             = std::to_string(startSeed);
+    options["timeLimitSeconds"] = std::to_string(std::max(0.0, remaining));
+    g.minSumLivenessAnneal(options);
+
+    sumLivenesses[start] = g.getSumLiveness();
+    schedules[start]     = g.getScheduleToOp();
+    return true;
+  });
+
+  uint64_t best = 0;
+  for (uint64_t start = 1; start < nStarts; ++start) {
+    if (sumLivenesses[start] < sumLivenesses[best]) {
+      best = start;
+    }
+  }
+
+  std::ostringstream oss;
+  oss << "Portfolio of " << nStarts << " starts, best start is " << best
+      << " with sum liveness " << sumLivenesses[best] << '.';
+  log().info(oss.str());
+
+  setSchedule(std::move(schedules[best]));
+}
+
+void Graph::minSumLivenessAnnealMultilevel(
+    uint64_t coarsestNOps,
+    const std::map<std::string, std::string> &annealOptions) {
+
+  if (!isInitialized) {
+    throw error("minSumLivenessAnnealMultilevel should only be called after "
+                "initialize(.,.)");
+  }
+
+  if (hasPendingEdits()) {
+    throw error("The Graph has been edited since it was initialized, "
+                "updateSchedule must be called before "
+                "minSumLivenessAnnealMultilevel");
+  }
+
+  // levels[0] is coarsened from this Graph, levels[i + 1] from levels[i]
+  std::vector<OpMerged> levels;
+  auto finest = [this, &levels]() -> const Graph & {
+    return levels.empty() ? *this : std::get<0>(levels.back());
+  };
+
+  if (hasAtLeastOneLink()) {
+    levels.push_back(getLinkMerged(false));
+  }
+
+  while (finest().nOps() > coarsestNOps) {
+    auto coarser =
+        finest().getMerged(finest().getCoarseningChains(), false);
+    if (10 * std::get<0>(coarser).nOps() > 9 * finest().nOps()) {
+      break;
+    }
+    levels.push_back(std::move(coarser));
+  }
+
+  std::ostringstream oss;
+  oss << "Multilevel annealing with " << levels.size()
+      << " coarsened Graphs, the coarsest with " << finest().nOps()
+      << " Ops.";
+  log().info(oss.str());
+
+  if (levels.empty()) {
+    minSumLivenessAnneal(annealOptions);
+    return;
+  }
+
+  auto &coarsest = std::get<0>(levels.back());
+  coarsest.initialize();
+  coarsest.minSumLivenessAnneal(annealOptions);
+
+  for (uint64_t level = levels.size(); level-- > 0;) {
+    const auto &child          = std::get<0>(levels[level]);
+    const auto &childToParents = std::get<1>(levels[level]);
+    std::vector<OpAddress> schedule;
+    for (auto childAddress : child.getScheduleToOp()) {
+      schedule.insert(schedule.end(),
+                      childToParents[childAddress].cbegin(),
+                      childToParents[childAddress].cend());
+    }
+
+    if (level == 0) {
+      assertValidSchedule(schedule);
+      setSchedule(std::move(schedule));
+      minSumLivenessAnneal(annealOptions);
+    } else {
+      auto &parent = std::get<0>(levels[level - 1]);
+      parent.initialize(schedule);
+      parent.minSumLivenessAnneal(annealOptions);
+    }
+  }
+}
+
+void Graph::minSumLivenessAnnealComponents(
+    uint32_t nThreads,
+    const std::map<std::string, std::string> &annealOptions) {
+
+  if (!isInitialized) {
+    throw error("minSumLivenessAnnealComponents should only be called after "
+                "initialize(.,.)");
+  }
+
+  if (nThreads == 0) {
+    throw error(
+        "nThreads must be positive in minSumLivenessAnnealComponents");
+  }
+
+  if (hasPendingEdits()) {
+    throw error("The Graph has been edited since it was initialized, "
+                "updateSchedule must be called before "
+                "minSumLivenessAnnealComponents");
+  }
+
+  const auto components = getComponents();
+
+  std::ostringstream oss;
+  oss << "Annealing " << components.size() << " connected components.";
+  log().info(oss.str());
+
+  if (components.size() < 2) {
+    minSumLivenessAnneal(annealOptions);
+    return;
+  }
+
+  constexpr uint64_t None{std::numeric_limits<uint64_t>::max()};
+  std::vector<uint64_t> componentOfOp(nOps());
+  std::vector<uint64_t> localOps(nOps());
+  std::vector<uint64_t> localAllocs(nAllocs(), None);
+  for (uint64_t c = 0; c < components.size(); ++c) {
+    uint64_t nLocalAllocs{0};
+    for (uint64_t i = 0; i < components[c].size(); ++i) {
+      const auto opAddress     = components[c][i];
+      componentOfOp[opAddress] = c;
+      localOps[opAddress]      = i;
+      for (auto allocAddress : getOp(opAddress).getAllocs()) {
+        if (localAllocs[allocAddress] == None) {
+          localAllocs[allocAddress] = nLocalAllocs;
+          ++nLocalAllocs;
+        }
+      }
+    }
+  }
+
+  // The initial schedule of each component, from the current schedule
+  std::vector<std::vector<OpAddress>> schedules(components.size());
+  for (auto opAddress : schToOp) {
+    schedules[componentOfOp[opAddress]].push_back(localOps[opAddress]);
+  }
+
+  // The largest components are started first
+  std::vector<uint64_t> order(components.size());
+  std::iota(order.begin(), order.end(), 0UL);
+  std::stable_sort(
+      order.begin(), order.end(), [&components](uint64_t a, uint64_t b) {
+        return components[a].size() > components[b].size();
+      });
+
+  util::ThreadPool threadPool(std::min<uint64_t>(
+      static_cast<uint64_t>(nThreads), components.size()));
+  threadPool.forEach(components.size(), [&](uint64_t task, uint64_t) {
+    const auto c = order[task];
+    auto g       = getComponentGraph(components[c], localOps, localAllocs);
+    g.initialize(schedules[c]);
+    g.minSumLivenessAnneal(annealOptions);
+    schedules[c] = g.getScheduleToOp();
+    return true;
+  });
+
+  std::vector<OpAddress> schedule;
+  schedule.reserve(nOps());
+  for (uint64_t c = 0; c < components.size(); ++c) {
+    for (auto localAddress : schedules[c]) {
+      schedule.push_back(components[c][localAddress]);
+    }
+  }
+  setSchedule(std::move(schedule));
 }
 
 namespace {
@@ -2025,6 +4285,91 @@ std::ostream &operator<<(std::ostream &ost, KahnTieBreaker ktb) {
   return ost;
 }
 
+namespace {
+
+std::array<std::string, NCoolingSchedules> initCoolingSchedules() {
+
+  constexpr const char *const unset{"unset"};
+  std::array<std::string, NCoolingSchedules> css;
+  for (uint64_t i = 0; i < NCoolingSchedules; ++i) {
+    css[i] = unset;
+  }
+  css[static_cast<uint64_t>(CoolingSchedule::GEOMETRIC)] = "Geometric";
+  css[static_cast<uint64_t>(CoolingSchedule::LINEAR)]    = "Linear";
+  css[static_cast<uint64_t>(CoolingSchedule::ADAPTIVEREHEAT)] =
+      "AdaptiveReheat";
+  for (uint64_t i = 0; i < NCoolingSchedules; ++i) {
+    if (css[i] == unset) {
+      throw error("Not all CoolingSchedule strings are set");
+    }
+  }
+  return css;
+}
+
+const std::array<std::string, NCoolingSchedules> &getCoolingSchedules() {
+  const auto static x = initCoolingSchedules();
+  return x;
+}
+
+} // namespace
+
+std::ostream &operator<<(std::ostream &ost, CoolingSchedule cs) {
+  ost << getCoolingSchedules()[static_cast<uint64_t>(cs)];
+  return ost;
+}
+
+CoolingSchedule coolingSchedule(const std::string &mixedCase) {
+  auto lower = util::lowercase(mixedCase);
+  for (uint64_t i = 0; i < NCoolingSchedules; ++i) {
+    if (lower == util::lowercase(getCoolingSchedules()[i])) {
+      return static_cast<CoolingSchedule>(i);
+    }
+  }
+  throw error("Invalid coolingSchedule string, " + mixedCase);
+}
+
+namespace {
+
+std::array<std::string, NLivenessObjectives> initLivenessObjectives() {
+
+  constexpr const char *const unset{"unset"};
+  std::array<std::string, NLivenessObjectives> los;
+  for (uint64_t i = 0; i < NLivenessObjectives; ++i) {
+    los[i] = unset;
+  }
+  los[static_cast<uint64_t>(LivenessObjective::SUM)]    = "Sum";
+  los[static_cast<uint64_t>(LivenessObjective::MAX)]    = "Max";
+  los[static_cast<uint64_t>(LivenessObjective::HYBRID)] = "Hybrid";
+  for (uint64_t i = 0; i < NLivenessObjectives; ++i) {
+    if (los[i] == unset) {
+      throw error("Not all LivenessObjective strings are set");
+    }
+  }
+  return los;
+}
+
+const std::array<std::string, NLivenessObjectives> &getLivenessObjectives() {
+  const auto static x = initLivenessObjectives();
+  return x;
+}
+
+} // namespace
+
+std::ostream &operator<<(std::ostream &ost, LivenessObjective lo) {
+  ost << getLivenessObjectives()[static_cast<uint64_t>(lo)];
+  return ost;
+}
+
+LivenessObjective livenessObjective(const std::string &mixedCase) {
+  auto lower = util::lowercase(mixedCase);
+  for (uint64_t i = 0; i < NLivenessObjectives; ++i) {
+    if (lower == util::lowercase(getLivenessObjectives()[i])) {
+      return static_cast<LivenessObjective>(i);
+    }
+  }
+  throw error("Invalid livenessObjective string, " + mixedCase);
+}
+
 void Graph::initialize(const std::map<std::string, std::string> &m) {
 
   auto ktb      = defaultKahnTieBreaker();
@@ -2061,7 +4406,58 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
                                  uint32_t seed,
                                  bool filterSusceptible,
                                  double timeLimitSeconds,
-                                 int64_t swapLimitCount) {
+                                 int64_t swapLimitCount,
+                                 uint32_t nThreads,
+                                 double initialTemperature,
+                                 CoolingSchedule cooling,
+                                 uint32_t nTemperatureSteps,
+                                 double coolingRate,
+                                 LivenessObjective objective,
+                                 double maxWeight,
+                                 uint64_t nTabuIterations,
+                                 uint32_t tabuTenure,
+                                 double targetGapPercent,
+                                 uint64_t windowSize) {
+  AnnealOptions options;
+  options.algo               = algo;
+  options.debug              = debug;
+  options.seed               = seed;
+  options.filterSusceptible  = filterSusceptible;
+  options.timeLimitSeconds   = timeLimitSeconds;
+  options.swapLimitCount     = swapLimitCount;
+  options.nThreads           = nThreads;
+  options.initialTemperature = initialTemperature;
+  options.coolingSchedule    = cooling;
+  options.nTemperatureSteps  = nTemperatureSteps;
+  options.coolingRate        = coolingRate;
+  options.objective          = objective;
+  options.maxWeight          = maxWeight;
+  options.nTabuIterations    = nTabuIterations;
+  options.tabuTenure         = tabuTenure;
+  options.targetGapPercent   = targetGapPercent;
+  options.windowSize         = windowSize;
+  minSumLivenessAnneal(options);
+}
+
+void Graph::minSumLivenessAnneal(const AnnealOptions &options) {
+
+  const auto algo               = options.algo;
+  const auto debug              = options.debug;
+  const auto seed               = options.seed;
+  const auto filterSusceptible  = options.filterSusceptible;
+  const auto timeLimitSeconds   = options.timeLimitSeconds;
+  const auto swapLimitCount     = options.swapLimitCount;
+  const auto nThreads           = options.nThreads;
+  const auto initialTemperature = options.initialTemperature;
+  const auto cooling            = options.coolingSchedule;
+  const auto nTemperatureSteps  = options.nTemperatureSteps;
+  const auto coolingRate        = options.coolingRate;
+  const auto objective          = options.objective;
+  const auto maxWeight          = options.maxWeight;
+  const auto nTabuIterations    = options.nTabuIterations;
+  const auto tabuTenure         = options.tabuTenure;
+  const auto targetGapPercent   = options.targetGapPercent;
+  const auto windowSize         = options.windowSize;
 
   if (log().shouldLog(logging::Level::Debug)) {
     std::ostringstream oss0;
@@ -2070,30 +4466,135 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
          << spaces << "seed=" << seed << '\n'
          << spaces << "filterSusceptible=" << filterSusceptible << '\n'
          << spaces << "timeLimitSeconds=" << timeLimitSeconds << '\n'
-         << spaces << "swapLimitCount=" << swapLimitCount;
+         << spaces << "swapLimitCount=" << swapLimitCount << '\n'
+         << spaces << "nThreads=" << nThreads << '\n'
+         << spaces << "initialTemperature=" << initialTemperature << '\n'
+         << spaces << "coolingSchedule=" << cooling << '\n'
+         << spaces << "nTemperatureSteps=" << nTemperatureSteps << '\n'
+         << spaces << "coolingRate=" << coolingRate << '\n'
+         << spaces << "objective=" << objective << '\n'
+         << spaces << "maxWeight=" << maxWeight << '\n'
+         << spaces << "nTabuIterations=" << nTabuIterations << '\n'
+         << spaces << "tabuTenure=" << tabuTenure << '\n'
+         << spaces << "targetGapPercent=" << targetGapPercent << '\n'
+         << spaces << "windowSize=" << windowSize;
     log().debug(oss0.str());
   }
 
+  if (nThreads == 0) {
+    throw error("nThreads must be positive in minSumLivenessAnneal");
+  }
+
+  if (hasPendingEdits()) {
+    throw error("The Graph has been edited since it was initialized, "
+                "updateSchedule must be called before minSumLivenessAnneal");
+  }
+
+  if (initialTemperature < 0.0) {
+    throw error("initialTemperature must be non-negative in "
+                "minSumLivenessAnneal");
+  }
+
+  if (initialTemperature > 0.0 && algo != MinSumLivenessAlgo::RIPPLE) {
+    throw error("The temperature phase of minSumLivenessAnneal requires the "
+                "RIPPLE algorithm");
+  }
+
+  if (cooling != CoolingSchedule::LINEAR &&
+      !(coolingRate > 0.0 && coolingRate < 1.0)) {
+    std::ostringstream oss;
+    oss << "coolingRate must be in (0, 1) in minSumLivenessAnneal with "
+        << "the " << cooling << " CoolingSchedule, not " << coolingRate;
+    throw error(oss.str());
+  }
+
+  const bool peakObjective = objective != LivenessObjective::SUM;
+  if (peakObjective && algo != MinSumLivenessAlgo::RIPPLE) {
+    throw error("The Max and Hybrid objectives of minSumLivenessAnneal "
+                "require the RIPPLE algorithm");
+  }
+
+  if (hasLivenessCap() && algo != MinSumLivenessAlgo::RIPPLE) {
+    throw error("The liveness cap of minSumLivenessAnneal requires the "
+                "RIPPLE algorithm");
+  }
+
+  if (hasLivenessCap()) {
+    assertSingleResourceClass();
+  }
+
+  if (objective == LivenessObjective::HYBRID && !(maxWeight >= 0.0)) {
+    throw error("maxWeight must be non-negative in minSumLivenessAnneal");
+  }
+
+  if (nTabuIterations > 0 && peakObjective) {
+    throw error("The tabu phase of minSumLivenessAnneal requires the SUM "
+                "objective");
+  }
+
+  if (nTabuIterations > 0 && tabuTenure == 0) {
+    throw error("tabuTenure must be positive in minSumLivenessAnneal");
+  }
+
+  if (windowSize > maxWindowSize()) {
+    std::ostringstream oss;
+    oss << "windowSize in minSumLivenessAnneal must be at most "
+        << maxWindowSize() << ", not " << windowSize;
+    throw error(oss.str());
+  }
+
+  if (windowSize > 1 && peakObjective) {
+    throw error("The window phase of minSumLivenessAnneal requires the SUM "
+                "objective");
+  }
+
+  if (targetGapPercent >= 0.0 && peakObjective) {
+    throw error("targetGapPercent in minSumLivenessAnneal requires the SUM "
+                "objective");
+  }
+
   std::mt19937 g(seed);
 
   auto resetSusceptibleTrue = [this, filterSusceptible]() {
     if (filterSusceptible) {
-      susceptible.resize(nOps());
-      std::fill(susceptible.begin(), susceptible.end(), true);
+      susceptible.assign(nOps(), false);
+      susceptibleList.clear();
+      susceptibleList.reserve(nOps());
+      for (uint64_t a = 0; a < nOps(); ++a) {
+        if (annealRegion.empty() || annealRegion[a]) {
+          setSusceptible(a);
+        }
+      }
     }
   };
 
-  auto resetSusceptibleFalse = [this, filterSusceptible]() {
-    if (filterSusceptible) {
-      susceptible.resize(nOps());
-      std::fill(susceptible.begin(), susceptible.end(), false);
+  // The sum liveness at or below which annealing stops, as it is then
+  // within targetGapPercent of the lower bound
+  const bool stopAtGap = targetGapPercent >= 0.0;
+  AllocWeight lowerBound{0};
+  AllocWeight gapTarget{0};
+  if (stopAtGap) {
+    lowerBound     = getSumLivenessLowerBound();
+    auto tolerance = absolute(lowerBound);
+    tolerance *= targetGapPercent / 100.0;
+    gapTarget = lowerBound + tolerance;
+    if (log().shouldLogInfo()) {
+      std::ostringstream oss;
+      oss << "Sum liveness = " << getSumLiveness()
+          << ", lower bound = " << lowerBound;
+      log().info(oss.str());
     }
+  }
+  auto withinTargetGap = [stopAtGap, &gapTarget, this]() {
+    return stopAtGap && getSumLiveness() <= gapTarget;
   };
 
   // look for moves of this shift length
   int nToShift{1};
-  bool continueAnnealing =
-      (timeLimitSeconds <= 0 || swapLimitCount <= 0) ? false : true;
+  bool continueAnnealing = (timeLimitSeconds <= 0 || swapLimitCount <= 0 ||
+                            isCancelled(options) || withinTargetGap())
+                               ? false
+                               : true;
 
   int nChangesAtCurrentShift{0};
 
@@ -2109,9 +4610,13 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
   double timeSpentInTotal{0.0};
 
   int64_t nChangesInTotal{0};
+  uint64_t nRounds{0};
+  uint64_t nUphillAccepted{0};
 
-  std::vector<OpAddress> allOpAddresses(nOps());
-  std::iota(allOpAddresses.begin(), allOpAddresses.end(), 0UL);
+  // The Ops considered in the current round, as the first Op of the range
+  // to shift. Without filterSusceptible, this is all Ops.
+  std::vector<OpAddress> candidates(nOps());
+  std::iota(candidates.begin(), candidates.end(), 0UL);
 
   auto startCurrentShift = std::chrono::high_resolution_clock::now();
 
@@ -2122,77 +4627,278 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
 
   resetSusceptibleTrue();
 
+  const auto nThreads_u64 = static_cast<uint64_t>(nThreads);
+  util::ThreadPool threadPool(nThreads_u64);
+
+  // Use doubles in the ripple algorithm if possible, as it is faster. The
+  // shifts found are identical.
+  setScalarAllocWeights();
+  const bool scalarRipple = hasScalarAllocWeights();
+  log().debug(std::string("Using ") + (scalarRipple ? "scalar" : "vector") +
+              " Alloc weights in the ripple algorithm.");
+
+  // One scratchpad per thread, of the type used. They are moved into place,
+  // as copies would not have the reserved capacities.
+  std::vector<RippleScratch<double>> scalarScratches;
+  std::vector<RippleScratch<AllocWeight>> rippleScratches;
+  for (uint64_t thread = 0; thread < nThreads_u64; ++thread) {
+    if (scalarRipple) {
+      scalarScratches.push_back(getInitialRippleScratch<double>());
+    } else {
+      rippleScratches.push_back(getInitialRippleScratch<AllocWeight>());
+    }
+  }
+
+  // The temperature phase, which is followed by the T=0 phase below.
+  if (initialTemperature > 0.0 && nTemperatureSteps > 0 &&
+      continueAnnealing) {
+    const auto startTemperaturePhase =
+        std::chrono::high_resolution_clock::now();
+    auto temperatureAnnealSwitch = [&](auto w) {
+      temperatureAnneal<decltype(w)>(
+          options, totalDeltaSumLiveness, nChangesInTotal, nUphillAccepted);
+    };
+    if (scalarRipple) {
+      temperatureAnnealSwitch(double{0});
+    } else {
+      temperatureAnnealSwitch(AllocWeight::zero());
+    }
+    std::chrono::duration<double> elapsedTemperaturePhase =
+        std::chrono::high_resolution_clock::now() - startTemperaturePhase;
+    timeSpentInTotal += elapsedTemperaturePhase.count();
+    resetSusceptibleTrue();
+  }
+
+  // The best shift found for each index of candidates
+  std::vector<ShiftAndCost> shiftAndCosts(nOps(), {0, AllocWeight::zero()});
+
+  // For the Max and Hybrid objectives, the change in sum liveness of the
+  // best shift of each Op is stored, as the cost in shiftAndCosts is not it.
+  std::vector<AllocWeight> peakSumCosts;
+  if (peakObjective) {
+    peakSumCosts.resize(nOps(), AllocWeight::zero());
+  }
+
+  // Ops which were susceptible at the start of the current round
+  std::vector<bool> susceptibleCurrent;
+  std::vector<OpAddress> susceptibleCurrentList;
+  std::vector<ScheduleIndex> susceptibleIndices;
+  if (filterSusceptible) {
+    susceptibleCurrent.resize(nOps(), false);
+    susceptibleCurrentList.reserve(nOps());
+    susceptibleIndices.reserve(nOps());
+  }
+
+  // The best shift of the nToShift Ops starting at the Op opAddress0. If no
+  // shift need be considered, a shift of 0 (with cost 0) is returned. This
+  // lambda is called concurrently, and so must not modify the Graph.
+  auto getBestShift = [this,
+                       algo,
+                       debug,
+                       filterSusceptible,
+                       scalarRipple,
+                       peakObjective,
+                       objective,
+                       maxWeight,
+                       &nToShift,
+                       &susceptibleCurrent,
+                       &scalarScratches,
+                       &rippleScratches,
+                       &peakSumCosts](OpAddress opAddress0,
+                                      uint64_t thread) {
+    const ShiftAndCost noShift{0, AllocWeight::zero()};
+
+    auto start0     = opToSchedule(opAddress0);
+    const auto &op0 = getOp(opAddress0);
+    if (start0 > nOps_i32() - nToShift) {
+      return noShift;
+    }
+
+    const auto &op1 = getOp(scheduleToOp(start0 + nToShift - 1));
+
+    // if links at end or start, can igonore. Consider
+    //
+    //    a op0 b c op1 d
+    //      -----------
+    //
+    // if a is linked to op0, any shift of op0-b-c-op1 would break this
+    // link: not allowed
+    //
+    // if op1 is linked to d, any shift of op0-b-c-op1 would break this
+    // link: not allowed.
+    //
+    if (op0.hasBackwardLink() || op1.hasForwardLink()) {
+      return noShift;
+    }
+
+    if (filterSusceptible &&
+        std::all_of(schToOp.begin() + start0,
+                    schToOp.begin() + start0 + nToShift,
+                    [&susceptibleCurrent](OpAddress a) {
+                      return !susceptibleCurrent[a];
+                    })) {
+      return noShift;
+    }
+
+    if (peakObjective && scalarRipple) {
+      return getBestShiftPeakAlgo(start0,
+                                  nToShift,
+                                  objective,
+                                  maxWeight,
+                                  scalarScratches[thread],
+                                  peakSumCosts[opAddress0]);
+    } else if (peakObjective) {
+      return getBestShiftPeakAlgo(start0,
+                                  nToShift,
+                                  objective,
+                                  maxWeight,
+                                  rippleScratches[thread],
+                                  peakSumCosts[opAddress0]);
+    }
+
+    if (hasLivenessCap() && scalarRipple) {
+      return getBestShiftCappedAlgo(
+          start0, nToShift, scalarScratches[thread]);
+    } else if (hasLivenessCap()) {
+      return getBestShiftCappedAlgo(
+          start0, nToShift, rippleScratches[thread]);
+    }
+
+    ShiftAndCost shiftAndCost{-1, -1 * AllocWeight::negativeOne()};
+    if (algo == MinSumLivenessAlgo::RIPPLE && scalarRipple) {
+      shiftAndCost =
+          getBestShiftRippleAlgo(start0, nToShift, scalarScratches[thread]);
+    } else if (algo == MinSumLivenessAlgo::RIPPLE) {
+      shiftAndCost =
+          getBestShiftRippleAlgo(start0, nToShift, rippleScratches[thread]);
+    } else {
+      shiftAndCost = getBestShiftSimpleAlgo(start0, nToShift);
+    }
+
+    if (debug) {
+      confirmShiftAndCost(start0, nToShift, shiftAndCost, algo);
+    }
+    return shiftAndCost;
+  };
+
+  // The index of candidates at which the current search starts, and the
+  // lowest index of candidates at which an improving shift has been found.
+  uint64_t searchStart{0};
+  std::atomic<uint64_t> firstImproving{0};
+
+  // The task run by the ThreadPool. It is constructed once, rather than for
+  // every search, as constructing a std::function with this many captures
+  // allocates.
+  const util::ThreadPool::Task searchTask = [this,
+                                             &searchStart,
+                                             &options,
+                                             &candidates,
+                                             &shiftAndCosts,
+                                             &firstImproving,
+                                             &getBestShift](uint64_t task,
+                                                            uint64_t thread) {
+    if (isCancelled(options)) {
+      return false;
+    }
+    const auto index     = searchStart + task;
+    shiftAndCosts[index] = getBestShift(candidates[index], thread);
+    if (!(shiftAndCosts[index].getCost() < AllocWeight(0))) {
+      return true;
+    }
+    auto current = firstImproving.load();
+    while (index < current &&
+           !firstImproving.compare_exchange_weak(current, index)) {
+    }
+    return false;
+  };
+
   while (continueAnnealing) {
 
-    auto susceptibleCurrent = susceptible;
-    resetSusceptibleFalse();
+    // When annealing is restricted to a region, the region grows to include
+    // all Ops which became susceptible in the previous round.
+    if (!annealRegion.empty() && filterSusceptible) {
+      for (auto a : susceptibleList) {
+        annealRegion[a] = true;
+      }
+    }
+
+    // The Ops which became susceptible in the previous round are the ones
+    // considered in this round, and susceptible starts this round empty.
+    if (filterSusceptible) {
+      for (auto a : susceptibleCurrentList) {
+        susceptibleCurrent[a] = false;
+      }
+      susceptibleCurrentList.clear();
+      std::swap(susceptible, susceptibleCurrent);
+      std::swap(susceptibleList, susceptibleCurrentList);
+    }
 
     auto startCurrentRound = std::chrono::high_resolution_clock::now();
 
+    // With filterSusceptible, the candidates are the first Ops of all ranges
+    // of nToShift Ops which contain a susceptible Op, so that the cost of a
+    // round is proportional to the number of susceptible Ops, not to nOps().
+    // They are collected in schedule order, so that the order below depends
+    // only on the seed.
+    if (filterSusceptible) {
+      susceptibleIndices.clear();
+      for (auto a : susceptibleCurrentList) {
+        susceptibleIndices.push_back(opToSchedule(a));
+      }
+      std::sort(susceptibleIndices.begin(), susceptibleIndices.end());
+      candidates.clear();
+      ScheduleIndex nextStart{0};
+      for (auto end0 : susceptibleIndices) {
+        for (auto start0 = std::max(nextStart, end0 - nToShift + 1);
+             start0 <= end0;
+             ++start0) {
+          candidates.push_back(scheduleToOp(start0));
+        }
+        nextStart = end0 + 1;
+      }
+    }
+
     // in each round. the order in which the indices are considered is
     // different. The idea is that this prevents bad cases analogous to bad
     // hash functions, although these haven't been obsereved at time of
     // commenting
-    std::shuffle(allOpAddresses.begin(), allOpAddresses.end(), g);
+    std::shuffle(candidates.begin(), candidates.end(), g);
 
     nChangesInCurrentRound  = 0;
     deltaWeightCurrentRound = AllocWeight::zero();
-    for (auto opAddress0 : allOpAddresses) {
-
-      auto start0     = opToSchedule(opAddress0);
-      const auto &op0 = getOp(opAddress0);
-      if (start0 > nOps_i32() - nToShift) {
-        continue;
-      }
-
-      const auto &op1 = getOp(scheduleToOp(start0 + nToShift - 1));
-
-      // if links at end or start, can igonore. Consider
-      //
-      //    a op0 b c op1 d
-      //      -----------
-      //
-      // if a is linked to op0, any shift of op0-b-c-op1 would break this
-      // link: not allowed
-      //
-      // if op1 is linked to d, any shift of op0-b-c-op1 would break this
-      // link: not allowed.
-      //
-      if (op0.hasBackwardLink() || op1.hasForwardLink()) {
-        continue;
-      }
 
-      if (filterSusceptible &&
-          std::all_of(schToOp.begin() + start0,
-                      schToOp.begin() + start0 + nToShift,
-                      [&susceptibleCurrent](OpAddress a) {
-                        return !susceptibleCurrent[a];
-                      })) {
-        continue;
+    // The search is distributed across threads. The improvement at the
+    // lowest index of candidates is applied, and the search resumes from
+    // the index following it, as in the serial algorithm.
+    const uint64_t nCandidates = candidates.size();
+    uint64_t nextIndex{0};
+    while (nextIndex < nCandidates) {
+      searchStart = nextIndex;
+      firstImproving.store(nCandidates);
+      threadPool.forEach(nCandidates - searchStart, searchTask);
+
+      // A shift found before cancellation is not applied
+      if (firstImproving.load() == nCandidates || isCancelled(options)) {
+        break;
       }
 
-      ShiftAndCost shiftAndCost{-1, -1 * AllocWeight::negativeOne()};
-      if (algo == MinSumLivenessAlgo::RIPPLE) {
-        shiftAndCost = getBestShiftRippleAlgo(start0, nToShift);
-      } else {
-        shiftAndCost = getBestShiftSimpleAlgo(start0, nToShift);
-      }
+      const auto index         = firstImproving.load();
+      const auto &shiftAndCost = shiftAndCosts[index];
+      const auto start0        = opToSchedule(candidates[index]);
+      auto start1              = start0 + shiftAndCost.getShift();
+      ScheduleChange scheduleChange{start0, start1, nToShift};
+      applyChange(scheduleChange);
 
       if (debug) {
-        confirmShiftAndCost(start0, nToShift, shiftAndCost, algo);
+        assertCorrectness();
       }
-      if (shiftAndCost.getCost() < AllocWeight(0)) {
-        auto start1 = start0 + shiftAndCost.getShift();
-        ScheduleChange scheduleChange{start0, start1, nToShift};
-        applyChange(scheduleChange);
+      ++nChangesInCurrentRound;
+      deltaWeightCurrentRound += shiftAndCost.getCost();
+      totalDeltaSumLiveness +=
+          peakObjective ? peakSumCosts[candidates[index]]
+                        : shiftAndCost.getCost();
 
-        if (debug) {
-          assertCorrectness();
-        }
-        ++nChangesInCurrentRound;
-        deltaWeightCurrentRound += shiftAndCost.getCost();
-        totalDeltaSumLiveness += shiftAndCost.getCost();
-      }
+      nextIndex = index + 1;
     }
 
     nChangesAtCurrentShift += nChangesInCurrentRound;
@@ -2205,33 +4911,68 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
         finishCurrentRound - startCurrentRound;
     timeSpentInCurrentRound = elapsedCurrentRound.count();
     timeSpentInTotal += timeSpentInCurrentRound;
+
+    // the callback may cancel, which is checked below
+    ++nRounds;
+    if (options.progressCallback) {
+      options.progressCallback({nRounds,
+                                nToShift,
+                                nChangesInCurrentRound,
+                                getSumLiveness(),
+                                timeSpentInTotal,
+                                nUphillAccepted});
+    }
+
     if (timeSpentInTotal > timeLimitSeconds) {
       continueAnnealing = false;
     }
     if (nChangesInTotal >= swapLimitCount) {
       continueAnnealing = false;
     }
+    if (isCancelled(options)) {
+      log().info("Annealing cancelled");
+      continueAnnealing = false;
+    }
+    if (withinTargetGap()) {
+      log().info("Sum liveness is within targetGapPercent of the lower "
+                 "bound, stopping");
+      continueAnnealing = false;
+    }
 
     auto oldNToShift = nToShift;
 
+    // The message is only constructed if it is logged, as rounds late in
+    // annealing are short, and should not allocate.
+    const bool logRound = log().shouldLogInfo();
     std::ostringstream oss;
-    oss << "nChangesInCurrentRound = " << nChangesInCurrentRound << " ";
+    if (logRound) {
+      oss << "nChangesInCurrentRound = " << nChangesInCurrentRound << " ";
+    }
 
     if (noChangeSinceStart) {
-      oss << "noChangeSinceStart, so " << nToShift << " --> " << nToShift + 1;
+      if (logRound) {
+        oss << "noChangeSinceStart, so " << nToShift << " --> "
+            << nToShift + 1;
+      }
       ++nToShift;
       resetSusceptibleTrue();
     } else if (nChangesInCurrentRound == 0) {
-      oss << "no changes, so " << nToShift << " -->  1, cleanSlate";
+      if (logRound) {
+        oss << "no changes, so " << nToShift << " -->  1, cleanSlate";
+      }
       nToShift           = 1;
       noChangeSinceStart = true;
       resetSusceptibleTrue();
     } else {
-      oss << "staying at " << nToShift;
+      if (logRound) {
+        oss << "staying at " << nToShift;
+      }
       nToShift = oldNToShift;
     }
 
-    log().info(oss.str());
+    if (logRound) {
+      log().info(oss.str());
+    }
 
     if (oldNToShift != nToShift) {
       updateCanCan(oldNToShift, nToShift);
@@ -2253,7 +4994,49 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
     }
   }
 
-  // Algorithm complete. Gather final statistics and test for error.
+  // The next call to minSumLivenessAnneal starts with 1-shifts, and this
+  // one may have been stopped at a larger shift by a limit.
+  if (nToShift != 1) {
+    updateCanCan(nToShift, 1);
+  }
+
+  // The window phase, which uses the limits remaining after the T=0 search.
+  if (windowSize > 1 && timeSpentInTotal < timeLimitSeconds &&
+      nChangesInTotal < swapLimitCount && !isCancelled(options) &&
+      !withinTargetGap()) {
+    const auto startWindowPhase = std::chrono::high_resolution_clock::now();
+    windowSearch(options,
+                 timeLimitSeconds - timeSpentInTotal,
+                 swapLimitCount - nChangesInTotal,
+                 totalDeltaSumLiveness,
+                 nChangesInTotal);
+    std::chrono::duration<double> elapsedWindowPhase =
+        std::chrono::high_resolution_clock::now() - startWindowPhase;
+    timeSpentInTotal += elapsedWindowPhase.count();
+  }
+
+  // The tabu phase, which uses the limits remaining after the earlier
+  // phases.
+  if (nTabuIterations > 0 && timeSpentInTotal < timeLimitSeconds &&
+      nChangesInTotal < swapLimitCount && !isCancelled(options) &&
+      !withinTargetGap()) {
+    auto tabuSwitch = [&](auto w) {
+      tabuSearch<decltype(w)>(options,
+                              timeLimitSeconds - timeSpentInTotal,
+                              swapLimitCount - nChangesInTotal,
+                              totalDeltaSumLiveness,
+                              nChangesInTotal);
+    };
+    if (scalarRipple) {
+      tabuSwitch(double{0});
+    } else {
+      tabuSwitch(AllocWeight::zero());
+    }
+  }
+
+  // Algorithm complete. Gather final statistics and test for error. The
+  // liveness is recomputed from scratch, which checks the incremental
+  // updates, and removes any rounding error accumulated in them.
 
   setSchToLiveness();
 
@@ -2284,86 +5067,107 @@ void Graph::minSumLivenessAnneal(MinSumLivenessAlgo algo,
          << '\n'
          << spaces << "init max liveness =  " << initMaxLiveness << '\n'
          << spaces << "final max liveness = " << finalMaxLiveness << '.';
+    if (stopAtGap) {
+      oss0 << '\n'
+           << spaces << "sum liveness lower bound = " << lowerBound << '.';
+    }
+    const auto nResources = nResourceClasses();
+    if (nResources > 1) {
+      for (ResourceClass r = 0; r < nResources; ++r) {
+        oss0 << '\n'
+             << spaces << "resource " << r
+             << " : sum liveness = " << getSumLiveness(r)
+             << ", max liveness = " << getMaxLiveness(r) << '.';
+      }
+    }
     log().info(oss0.str());
   }
+
+  assertLivenessCapMet();
 }
 
 void Graph::setOpToInSch(OpAddress opAddress) {
-  opToInSch[opAddress].reserve(getOp(opAddress).nIns());
-  opToInSch[opAddress].clear();
-  for (OpAddress inAddress : getOp(opAddress).getIns()) {
-    opToInSch[opAddress].push_back(opToSch[inAddress]);
+  auto row        = opToInSch.row(opAddress);
+  const auto &ins = getOp(opAddress).getIns();
+  for (uint64_t i = 0; i < ins.size(); ++i) {
+    row[i] = opToSch[ins[i]];
   }
-  std::sort(opToInSch[opAddress].begin(), opToInSch[opAddress].end());
+  std::sort(row.begin(), row.end());
 }
 
 void Graph::setOpToOutSch(OpAddress opAddress) {
-  opToOutSch[opAddress].reserve(getOp(opAddress).nOuts());
-  opToOutSch[opAddress].clear();
-  for (OpAddress outAddress : getOp(opAddress).getOuts()) {
-    opToOutSch[opAddress].push_back(opToSch[outAddress]);
+  auto row         = opToOutSch.row(opAddress);
+  const auto &outs = getOp(opAddress).getOuts();
+  for (uint64_t i = 0; i < outs.size(); ++i) {
+    row[i] = opToSch[outs[i]];
   }
-  std::sort(opToOutSch[opAddress].begin(), opToOutSch[opAddress].end());
+  std::sort(row.begin(), row.end());
 }
 
 void Graph::setAllocToSch(AllocAddress allocAddress) {
-  allocToSch[allocAddress].reserve(getAlloc(allocAddress).nOps());
-  allocToSch[allocAddress].clear();
-  for (OpAddress opAddress : getAlloc(allocAddress).getOps()) {
-    allocToSch[allocAddress].push_back(opToSch[opAddress]);
+  auto row        = allocToSch.row(allocAddress);
+  const auto &ops = getAlloc(allocAddress).getOps();
+  for (uint64_t i = 0; i < ops.size(); ++i) {
+    row[i] = opToSch[ops[i]];
   }
-  std::sort(allocToSch[allocAddress].begin(), allocToSch[allocAddress].end());
+  std::sort(row.begin(), row.end());
 }
 
-std::vector<AllocWeight> Graph::getBwdRippleCosts(ScheduleIndex start0,
-                                                  int nToShift,
-                                                  int lastExtProd) const {
+template <typename W>
+const std::vector<W> &
+Graph::getBwdRippleCosts(ScheduleIndex start0,
+                         int nToShift,
+                         int lastExtProd,
+                         RippleScratch<W> &rippleScratch) const {
 
   const int sign             = -1;
   const auto nCostsToCompute = start0 - lastExtProd - 1;
   const auto dirOffset       = 0;
-  return getRippleCosts(start0, nToShift, sign, nCostsToCompute, dirOffset);
+  return getRippleCosts(
+      start0, nToShift, sign, nCostsToCompute, dirOffset, rippleScratch);
 }
 
 // this was the trickiest function to get right
-std::vector<AllocWeight> Graph::getRippleCosts(ScheduleIndex start0,
-                                               int nToShift,
-                                               int sign,
-                                               int nCostsToCompute,
-                                               int dirOffset) const {
+template <typename W>
+const std::vector<W> &
+Graph::getRippleCosts(ScheduleIndex start0,
+                      int nToShift,
+                      int sign,
+                      int nCostsToCompute,
+                      int dirOffset,
+                      RippleScratch<W> &rippleScratch) const {
 
   const auto boundEnd = nCostsToCompute + sign * start0 + 1;
 
-  std::vector<AllocWeight> costs;
-  costs.reserve(static_cast<uint64_t>(nCostsToCompute));
+  auto &costs = rippleScratch.costs;
+  costs.clear();
 
   // Cumulative cost for starts, increasing away from start0
-  AllocWeight w{0};
+  W w{0};
 
-  AllocWeight toIncrement{0};
+  W toIncrement{0};
 
-  std::vector<AllocAddress> liveAllocAddresses;
+  auto &entries            = rippleScratch.entries;
+  auto &liveAllocAddresses = rippleScratch.liveAllocs;
+  liveAllocAddresses.clear();
 
   // the usual suspects
   auto x0 = start0;
   auto o0 = start0 + nToShift;
 
   // initialize registry and toIncrement
-  auto initialAllocAddresses = getAllocAddresses(x0, o0);
-  liveAllocAddresses.reserve(
-      initialAllocAddresses.size() +
-      static_cast<uint64_t>(std::abs(boundEnd - start0)));
-  for (auto allocAddress : initialAllocAddresses) {
+  getAllocAddresses(x0, o0, rippleScratch.allocs);
+  for (auto allocAddress : rippleScratch.allocs) {
     const auto &schedInds = allocToSchedule(allocAddress);
     auto firstX =
         custom_lower_bound(schedInds.cbegin(), schedInds.cend(), x0);
     auto firstO       = custom_lower_bound(firstX, schedInds.cend(), o0);
     int isPre         = firstX != schedInds.cbegin();
     int isPost        = firstO != schedInds.cend();
-    const auto wAlloc = getAlloc(allocAddress).getWeight();
-    AllocWeight wIncr = sign * (isPre - isPost) * wAlloc;
+    const auto wAlloc = getRippleWeight<W>(allocAddress);
+    W wIncr           = sign * (isPre - isPost) * wAlloc;
     liveAllocAddresses.push_back(allocAddress);
-    rippleScratch[allocAddress] = {start0, AllocWeight::zero(), wIncr, true};
+    entries[allocAddress] = {start0, W(0), wIncr, true};
     toIncrement += wIncr;
   }
 
@@ -2374,8 +5178,8 @@ std::vector<AllocWeight> Graph::getRippleCosts(ScheduleIndex start0,
     // in "x" or existing "o" and remove all record on w and toIncrement
     auto start1Allocs = scheduleToAllocs(start1 + dirOffset);
     for (auto a : start1Allocs) {
-      if (rippleScratch[a].live) {
-        auto record = rippleScratch[a];
+      if (entries[a].live) {
+        const auto &record = entries[a];
         w -= record.entryWeight;
         auto incrTime = sign * (start1 - record.entryTime) - 1;
         w -= incrTime * record.incrWeight;
@@ -2388,7 +5192,7 @@ std::vector<AllocWeight> Graph::getRippleCosts(ScheduleIndex start0,
     // having removed  previous effect of allocs, insert up-to-date entries
     for (auto allocAddress : start1Allocs) {
       auto partCost =
-          getShiftCost(start0, start1, nToShift, getAlloc(allocAddress));
+          getShiftCost<W>(start0, start1, nToShift, allocAddress);
       const auto &schedInds = allocToSchedule(allocAddress);
       ScheduleIndex extremum;
       if (sign == -1) {
@@ -2399,18 +5203,18 @@ std::vector<AllocWeight> Graph::getRippleCosts(ScheduleIndex start0,
 
       // only in a special case will incrWeight be non-zero:
       // TODO(T14829) diagram explaining this special case.
-      auto newIncr = AllocWeight::zero();
+      auto newIncr = W(0);
       auto post0 =
           custom_lower_bound(schedInds.cbegin(), schedInds.cend(), start0);
       if (post0 != schedInds.cend() && *post0 - start0 < nToShift &&
           extremum == start1 + dirOffset) {
-        newIncr = getAlloc(allocAddress).getWeight();
+        newIncr = getRippleWeight<W>(allocAddress);
       }
 
-      if (!rippleScratch[allocAddress].live) {
+      if (!entries[allocAddress].live) {
         liveAllocAddresses.push_back(allocAddress);
       }
-      rippleScratch[allocAddress] = {start1, partCost, newIncr, true};
+      entries[allocAddress] = {start1, partCost, newIncr, true};
       w += partCost;
       toIncrement += newIncr;
     }
@@ -2420,32 +5224,25 @@ std::vector<AllocWeight> Graph::getRippleCosts(ScheduleIndex start0,
 
   // clear the scratchpad for future runs
   for (auto x : liveAllocAddresses) {
-    rippleScratch[x].live = false;
+    entries[x].live = false;
   }
   return costs;
 }
 
 AllocWeight Graph::getMaxLiveness() const {
-  if (schToLiveness.empty()) {
+  if (schToLiveness.size() == 0) {
     throw error(
         "Call go getMaxLiveness, but schToLiveness has not yet been set");
   }
-  return std::accumulate(
-      schToLiveness.cbegin(),
-      schToLiveness.cend(),
-      static_cast<AllocWeight>(0),
-      [](AllocWeight a, AllocWeight b) { return std::max(a, b); });
+  return std::max(AllocWeight(0), schToLiveness.max());
 }
 
 AllocWeight Graph::getSumLiveness() const {
-  if (schToLiveness.empty()) {
+  if (schToLiveness.size() == 0) {
     throw error(
         "Call go getSumLiveness, but schToLiveness has not yet been set");
   }
-  return std::accumulate(schToLiveness.cbegin(),
-                         schToLiveness.cend(),
-                         static_cast<AllocWeight>(0),
-                         [](AllocWeight a, AllocWeight b) { return a + b; });
+  return sumLiveness;
 }
 
 std::ostream &operator<<(std::ostream &ost, const Graph &x) {
@@ -2469,12 +5266,12 @@ void Graph::appendSerialization(std::ostream &ost) const {
   ost << "{\"ops\":[";
   if (nOps() != 0) {
     ost << newline;
-    getOp(0).appendSerialization(ost);
+    getOp(0).appendSerialization(ost, getDebugString(0));
   }
   for (uint64_t i = 1; i < nOps(); ++i) {
     ost << ',';
     ost << newline;
-    getOp(i).appendSerialization(ost);
+    getOp(i).appendSerialization(ost, getDebugString(i));
   }
   ost << "],\n\"allocs\":[";
   if (nAllocs() != 0) {
@@ -2486,7 +5283,18 @@ void Graph::appendSerialization(std::ostream &ost) const {
     ost << newline;
     getAlloc(i).appendSerialization(ost);
   }
-  ost << "]}";
+  ost << ']';
+  // Only if a resource weight has been set, with enough digits to be read
+  // back exactly
+  if (!resourceWeights.empty()) {
+    ost << ",\n\"resourceWeights\":["
+        << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (uint64_t r = 0; r < resourceWeights.size(); ++r) {
+      ost << (r == 0 ? "" : ",") << resourceWeights[r];
+    }
+    ost << ']';
+  }
+  ost << '}';
 }
 
 Graph Graph::fromSerializationString(const std::string &s) {
@@ -81,15 +81,26 @@ Graph fromSerializationString(const std::string &serialization) {
   // Gather Alloc data from boost data-structure
   std::vector<AllocAddress> allocAddresses;
   std::vector<std::vector<double>> weights;
+  std::vector<ResourceClass> resources;
   for (const auto &[k, allocEntry] : tree.get_child("allocs")) {
     (void)k;
     allocAddresses.push_back(allocEntry.get<AllocAddress>("address"));
+    // Graphs serialized before resource classes were added have none
+    resources.push_back(allocEntry.get<ResourceClass>("resource", 0));
     weights.push_back({});
     for (auto w : allocEntry.get_child("weight")) {
       weights.back().push_back(getNumericType<double>(w.second.data()));
     }
   }
 
+  // Graphs without resource weights set do not serialize them
+  std::vector<double> resourceWeights;
+  if (const auto entries = tree.get_child_optional("resourceWeights")) {
+    for (const auto &w : entries.get()) {
+      resourceWeights.push_back(getNumericType<double>(w.second.data()));
+    }
+  }
+
   // Map index in data from boost data-structure to OpAddresses,
   // AllocAddresses
   constexpr auto UnsetIndex = std::numeric_limits<uint64_t>::max();
@@ -132,7 +143,10 @@ Graph fromSerializationString(const std::string &serialization) {
     for (uint64_t i = 0; i < NAW; ++i) {
       v[i] = weights[ind][i];
     }
-    graph.insertAlloc(v);
+    graph.insertAlloc(v, resources[ind]);
+  }
+  for (ResourceClass r = 0; r < resourceWeights.size(); ++r) {
+    graph.setResourceWeight(r, resourceWeights[r]);
   }
 
   // 3) insert Links, Constrains, Op-Alloc associations
@@ -0,0 +1,277 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <tuple>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/logging.hpp>
+#include <poprithms/schedule/anneal/offsetplan.hpp>
+
+namespace poprithms {
+namespace schedule {
+namespace anneal {
+
+namespace {
+
+// Places the Allocs of one resource, in a given order
+class Placer {
+public:
+  Placer(const Graph &g, const std::vector<AllocAddress> &allocs) {
+    for (auto a : allocs) {
+      addresses.push_back(a);
+      firsts.push_back(g.allocToFirstSchedule(a));
+      finals.push_back(g.allocToFinalSchedule(a));
+      sizes.push_back(g.getAlloc(a).getWeight().getCentre());
+    }
+    offsets.resize(allocs.size(), 0.0);
+    ends.resize(allocs.size(), 0.0);
+    positions.resize(allocs.size(), 0);
+    setOverlaps();
+  }
+
+  uint64_t size() const { return addresses.size(); }
+
+  // Place the Allocs from position p of order on, the Allocs before it
+  // being where they were placed the last time
+  void place(const std::vector<uint64_t> &order, uint64_t p);
+
+  // The highest end of an Alloc placed at or before position p of order
+  double getPeak(uint64_t p) const { return p == 0 ? 0.0 : ends[p - 1]; }
+
+  double getEnd(uint64_t i) const { return offsets[i] + sizes[i]; }
+  double getOffset(uint64_t i) const { return offsets[i]; }
+  AllocAddress getAddress(uint64_t i) const { return addresses[i]; }
+
+  // Weight times the number of schedule indices at which Alloc i is live
+  double getArea(uint64_t i) const {
+    return sizes[i] * static_cast<double>(finals[i] - firsts[i] + 1);
+  }
+  ScheduleIndex getFirst(uint64_t i) const { return firsts[i]; }
+  double getSize(uint64_t i) const { return sizes[i]; }
+
+  // The max over schedule indices of the sum of the weights of the live
+  // Allocs, which no placement has a lower peak than
+  double getMaxLiveness() const;
+
+private:
+  // Set the Allocs which are live at the same time as each Alloc, by
+  // sweeping over them in order of their first schedule index
+  void setOverlaps();
+
+  std::vector<AllocAddress> addresses;
+  std::vector<ScheduleIndex> firsts;
+  std::vector<ScheduleIndex> finals;
+  std::vector<double> sizes;
+  std::vector<double> offsets;
+
+  // The highest end of the Allocs placed up to each position of the order
+  std::vector<double> ends;
+
+  std::vector<std::vector<uint64_t>> overlaps;
+
+  // The position of each Alloc in the order last placed
+  std::vector<uint64_t> positions;
+
+  // The [offset, end) of the placed Allocs which overlap the one being
+  // placed
+  std::vector<std::tuple<double, double>> placed;
+};
+
+void Placer::setOverlaps() {
+  const auto n = size();
+  overlaps.resize(n);
+  std::vector<uint64_t> byFirst(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    byFirst[i] = i;
+  }
+  std::sort(byFirst.begin(), byFirst.end(), [this](uint64_t a, uint64_t b) {
+    return std::make_tuple(firsts[a], a) < std::make_tuple(firsts[b], b);
+  });
+
+  // The Allocs seen so far which are live at the first schedule index of
+  // the current Alloc, or later
+  std::vector<uint64_t> open;
+  for (auto i : byFirst) {
+    open.erase(std::remove_if(open.begin(),
+                              open.end(),
+                              [this, i](uint64_t j) {
+                                return finals[j] < firsts[i];
+                              }),
+               open.end());
+    for (auto j : open) {
+      overlaps[i].push_back(j);
+      overlaps[j].push_back(i);
+    }
+    open.push_back(i);
+  }
+}
+
+double Placer::getMaxLiveness() const {
+  std::vector<std::tuple<ScheduleIndex, double>> events;
+  for (uint64_t i = 0; i < size(); ++i) {
+    events.push_back({firsts[i], sizes[i]});
+    events.push_back({finals[i] + 1, -sizes[i]});
+  }
+  // At equal schedule indices, the negative changes are first
+  std::sort(events.begin(), events.end());
+  double liveness{0.0};
+  double maxLiveness{0.0};
+  for (const auto &[index, change] : events) {
+    (void)index;
+    liveness += change;
+    maxLiveness = std::max(maxLiveness, liveness);
+  }
+  return maxLiveness;
+}
+
+void Placer::place(const std::vector<uint64_t> &order, uint64_t p) {
+  for (uint64_t q = p; q < order.size(); ++q) {
+    positions[order[q]] = q;
+  }
+  for (; p < order.size(); ++p) {
+    const auto i = order[p];
+    placed.clear();
+    for (auto j : overlaps[i]) {
+      if (positions[j] < p) {
+        placed.push_back({offsets[j], getEnd(j)});
+      }
+    }
+    std::sort(placed.begin(), placed.end());
+
+    // The smallest gap which the Alloc fits in, or above all of the placed
+    // Allocs if there is none
+    double top{0.0};
+    double bestOffset{-1.0};
+    double bestGap{0.0};
+    for (const auto &[offset, end] : placed) {
+      const auto gap = offset - top;
+      if (gap >= sizes[i] && (bestOffset < 0.0 || gap < bestGap)) {
+        bestOffset = top;
+        bestGap    = gap;
+      }
+      top = std::max(top, end);
+    }
+    offsets[i] = bestOffset < 0.0 ? top : bestOffset;
+    ends[p]    = std::max(getPeak(p), getEnd(i));
+  }
+}
+
+// Best fit in decreasing order of area, or in order of the first schedule
+// index if that is better, followed by the local search
+double plan(Placer &placer, uint64_t nLocalSearchIterations, uint32_t seed) {
+
+  const auto n = placer.size();
+  std::vector<uint64_t> byFirst(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    byFirst[i] = i;
+  }
+  auto order = byFirst;
+  std::sort(order.begin(), order.end(), [&placer](uint64_t a, uint64_t b) {
+    return std::make_tuple(-placer.getArea(a), -placer.getSize(a), a) <
+           std::make_tuple(-placer.getArea(b), -placer.getSize(b), b);
+  });
+  std::sort(
+      byFirst.begin(), byFirst.end(), [&placer](uint64_t a, uint64_t b) {
+        return std::make_tuple(placer.getFirst(a), -placer.getSize(a), a) <
+               std::make_tuple(placer.getFirst(b), -placer.getSize(b), b);
+      });
+  placer.place(byFirst, 0);
+  const auto byFirstPeak = placer.getPeak(n);
+  placer.place(order, 0);
+  auto peak = placer.getPeak(n);
+  if (byFirstPeak < peak) {
+    std::swap(order, byFirst);
+    placer.place(order, 0);
+    peak = byFirstPeak;
+  }
+
+  std::mt19937 g(seed);
+  std::vector<uint64_t> atPeak;
+  auto candidate        = order;
+  const auto lowerBound = placer.getMaxLiveness();
+  for (uint64_t iteration = 0;
+       iteration < nLocalSearchIterations && lowerBound < peak;
+       ++iteration) {
+
+    // The positions in the order of the Allocs which end at the peak. The
+    // first can not be moved earlier.
+    atPeak.clear();
+    for (uint64_t p = 1; p < n; ++p) {
+      if (placer.getEnd(order[p]) == peak) {
+        atPeak.push_back(p);
+      }
+    }
+    if (atPeak.empty()) {
+      break;
+    }
+
+    const auto from = atPeak[g() % atPeak.size()];
+    const auto to   = g() % from;
+    candidate       = order;
+    std::rotate(std::next(candidate.begin(), to),
+                std::next(candidate.begin(), from),
+                std::next(candidate.begin(), from + 1));
+    placer.place(candidate, to);
+    const auto candidatePeak = placer.getPeak(n);
+    if (candidatePeak <= peak) {
+      std::swap(order, candidate);
+      peak = candidatePeak;
+    } else {
+      placer.place(order, to);
+    }
+  }
+  return peak;
+}
+
+} // namespace
+
+OffsetPlan getOffsetPlan(const Graph &g,
+                         uint64_t nLocalSearchIterations,
+                         uint32_t seed) {
+
+  if (g.getScheduleToOp().size() != g.nOps()) {
+    throw error("The Graph must be initialized before its offsets are "
+                "planned");
+  }
+
+  std::vector<std::vector<AllocAddress>> resources(g.nResourceClasses());
+  for (const auto &alloc : g.getAllocs()) {
+    const auto &w = alloc.getWeight();
+    if (!w.isCentreOnly() || w.getCentre() < 0.0) {
+      std::ostringstream oss;
+      oss << "Offsets can only be planned for non-negative scalar Alloc "
+          << "weights, not " << w << " of Alloc " << alloc.getAddress();
+      throw error(oss.str());
+    }
+    if (alloc.nOps() > 0) {
+      resources[alloc.getResourceClass()].push_back(alloc.getAddress());
+    }
+  }
+
+  OffsetPlan offsetPlan;
+  offsetPlan.offsets.resize(g.nAllocs(), 0.0);
+  for (const auto &allocs : resources) {
+    Placer placer(g, allocs);
+    offsetPlan.peaks.push_back(plan(placer, nLocalSearchIterations, seed));
+    for (uint64_t i = 0; i < placer.size(); ++i) {
+      offsetPlan.offsets[placer.getAddress(i)] = placer.getOffset(i);
+    }
+  }
+
+  if (log().shouldLog(logging::Level::Debug)) {
+    std::ostringstream oss;
+    for (ResourceClass r = 0; r < offsetPlan.peaks.size(); ++r) {
+      oss << "\n  resource " << r << " : peak = " << offsetPlan.peaks[r]
+          << ", max liveness = " << g.getMaxLiveness(r) << '.';
+    }
+    log().debug("Planned offsets of the Allocs." + oss.str());
+  }
+
+  return offsetPlan;
+}
+
+} // namespace anneal
+} // namespace schedule
+} // namespace poprithms
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <array>
 #include <iomanip>
+#include <utility>
 
 #include <poprithms/schedule/anneal/error.hpp>
 #include <poprithms/schedule/anneal/op.hpp>
@@ -17,15 +18,17 @@ std::ostream &operator<<(std::ostream &ost, const Op &op) {
   return ost;
 }
 
-void Op::append(std::ostream &ost) const { ost << debugString; }
+void Op::append(std::ostream &ost) const { ost << "Op " << address; }
 
 void Op::sortAndMakeUnique() {
   ins    = util::unisorted(ins);
   outs   = util::unisorted(outs);
   allocs = util::unisorted(allocs);
+  sorted = true;
 }
 
-void Op::appendSerialization(std::ostream &ost) const {
+void Op::appendSerialization(std::ostream &ost,
+                             const std::string &debugString) const {
 
   ost << "{\"address\":" << address << ",\"outs\":[";
   if (nOuts() != 0) {
@@ -62,8 +65,20 @@ void Op::appendSerialization(std::ostream &ost) const {
       << "\",\"fwdLink\":" << fwdLinkFragment << "}";
 }
 
-Op::Op(OpAddress _address_, const std::string &_debugString_)
-    : address(_address_), debugString(_debugString_) {}
+Op::Op(OpAddress _address_, DebugStringId _debugStringId_)
+    : address(_address_), debugStringId(_debugStringId_) {}
+
+Op::Op(OpAddress _address_,
+       std::vector<OpAddress> _ins_,
+       std::vector<OpAddress> _outs_,
+       std::vector<AllocAddress> _allocs_,
+       DebugStringId _debugStringId_)
+    : address(_address_), ins(std::move(_ins_)), outs(std::move(_outs_)),
+      allocs(std::move(_allocs_)), debugStringId(_debugStringId_) {
+  sorted = std::is_sorted(ins.cbegin(), ins.cend()) &&
+           std::is_sorted(outs.cbegin(), outs.cend()) &&
+           std::is_sorted(allocs.cbegin(), allocs.cend());
+}
 
 } // namespace anneal
 } // namespace schedule
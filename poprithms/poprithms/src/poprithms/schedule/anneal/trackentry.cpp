@@ -6,8 +6,8 @@ namespace poprithms {
 namespace schedule {
 namespace anneal {
 
-TrackEntry::TrackEntry(ScheduleIndex a, AllocWeight b, AllocWeight c, bool d)
-    : entryTime(a), entryWeight(b), incrWeight(c), live(d) {}
+template class TrackEntry<AllocWeight>;
+template class TrackEntry<double>;
 
 } // namespace anneal
 } // namespace schedule
@@ -0,0 +1,38 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <functional>
+#include <limits>
+
+#include <poprithms/util/error.hpp>
+#include <poprithms/util/stringpool.hpp>
+
+namespace poprithms {
+namespace util {
+
+constexpr uint32_t StringPool::EmptyId;
+
+StringPool::StringPool() : strings(1) {}
+
+uint32_t StringPool::intern(const std::string &s) {
+  if (s.empty()) {
+    return EmptyId;
+  }
+
+  const uint64_t hash = std::hash<std::string>()(s);
+  const auto range    = idsByHash.equal_range(hash);
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    if (strings[iter->second] == s) {
+      return iter->second;
+    }
+  }
+
+  if (strings.size() > std::numeric_limits<uint32_t>::max()) {
+    throw error("util", "Too many distinct strings in StringPool");
+  }
+  const auto id = static_cast<uint32_t>(strings.size());
+  strings.push_back(s);
+  idsByHash.insert({hash, id});
+  return id;
+}
+
+} // namespace util
+} // namespace poprithms
@@ -0,0 +1,108 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <poprithms/util/error.hpp>
+#include <poprithms/util/threadpool.hpp>
+
+namespace poprithms {
+namespace util {
+
+ThreadPool::ThreadPool(uint64_t nThreads_) {
+  if (nThreads_ == 0) {
+    throw error("util", "A ThreadPool requires at least 1 thread");
+  }
+  workers.reserve(nThreads_ - 1);
+  for (uint64_t thread = 1; thread < nThreads_; ++thread) {
+    workers.emplace_back([this, thread]() { workerLoop(thread); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    terminate = true;
+  }
+  startCondition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::runTasks(uint64_t thread) {
+  while (true) {
+    const auto task = nextTask.fetch_add(1);
+    if (task >= currentNTasks) {
+      return;
+    }
+    bool continueTasks{false};
+    try {
+      continueTasks = (*currentTask)(task, thread);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mut);
+      if (!firstException) {
+        firstException = std::current_exception();
+      }
+    }
+
+    // Tasks are claimed in increasing order, so all tasks lower than "task"
+    // have already been claimed and will run to completion.
+    if (!continueTasks) {
+      nextTask.store(currentNTasks);
+      return;
+    }
+  }
+}
+
+void ThreadPool::workerLoop(uint64_t thread) {
+  uint64_t generationSeen{0};
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mut);
+      startCondition.wait(lock, [this, generationSeen]() {
+        return terminate || generation != generationSeen;
+      });
+      if (terminate) {
+        return;
+      }
+      generationSeen = generation;
+    }
+
+    runTasks(thread);
+
+    {
+      std::lock_guard<std::mutex> lock(mut);
+      --nWorkersActive;
+      if (nWorkersActive == 0) {
+        doneCondition.notify_all();
+      }
+    }
+  }
+}
+
+void ThreadPool::forEach(uint64_t nTasks, const Task &f) {
+  {
+    std::lock_guard<std::mutex> lock(mut);
+    currentTask    = &f;
+    currentNTasks  = nTasks;
+    firstException = nullptr;
+    nextTask.store(0);
+    nWorkersActive = workers.size();
+    ++generation;
+  }
+  startCondition.notify_all();
+
+  runTasks(0);
+
+  std::exception_ptr toRethrow;
+  {
+    std::unique_lock<std::mutex> lock(mut);
+    doneCondition.wait(lock, [this]() { return nWorkersActive == 0; });
+    currentTask = nullptr;
+    toRethrow   = firstException;
+  }
+
+  if (toRethrow) {
+    std::rethrow_exception(toRethrow);
+  }
+}
+
+} // namespace util
+} // namespace poprithms
@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// The search for shifts in minSumLivenessAnneal, and the application of the
+// improving shifts found, should not allocate: all workspaces are created
+// before the first round and then reused. The global operator new is
+// replaced with one which counts allocations, and no allocation should be
+// made between the ends of consecutive rounds after the first.
+
+namespace {
+std::atomic<uint64_t> nAllocations{0};
+}
+
+void *operator new(std::size_t n) {
+  ++nAllocations;
+  if (auto p = std::malloc(n == 0 ? 1 : n)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+// With capped, the liveness cap is the max liveness of the initial schedule
+void assertNoAllocationsInRounds(
+    const Graph &g0,
+    const std::string &description,
+    LivenessObjective objective = LivenessObjective::SUM,
+    bool capped                 = false) {
+
+  for (bool filterSusceptible : {false, true}) {
+    for (uint32_t nThreads : {1, 3}) {
+      auto g = g0;
+      g.initialize(KahnTieBreaker::RANDOM, 1011);
+      if (capped) {
+        g.setLivenessCap(g.getMaxLiveness());
+      }
+
+      // Reserved, so that the callback does not allocate
+      std::vector<uint64_t> nAllocationsAtRoundEnd;
+      nAllocationsAtRoundEnd.reserve(100000);
+
+      AnnealOptions options;
+      options.seed              = 1012;
+      options.filterSusceptible = filterSusceptible;
+      options.nThreads          = nThreads;
+      options.objective         = objective;
+      options.progressCallback  = [&nAllocationsAtRoundEnd](
+                                     const AnnealProgress &) {
+        nAllocationsAtRoundEnd.push_back(nAllocations.load());
+      };
+      g.minSumLivenessAnneal(options);
+
+      if (nAllocationsAtRoundEnd.size() < 3) {
+        throw error("Expected at least 3 rounds of annealing for " +
+                    description);
+      }
+
+      for (uint64_t i = 1; i < nAllocationsAtRoundEnd.size(); ++i) {
+        const auto n =
+            nAllocationsAtRoundEnd[i] - nAllocationsAtRoundEnd[i - 1];
+        if (n != 0) {
+          std::ostringstream oss;
+          oss << "Expected no allocations in round " << i + 1
+              << " of annealing for " << description << " with objective "
+              << objective << ", capped = " << capped
+              << ", filterSusceptible = " << filterSusceptible
+              << " and nThreads = " << nThreads << ", but there were "
+              << n << '.';
+          throw error(oss.str());
+        }
+      }
+    }
+  }
+}
+} // namespace
+
+int main() {
+
+  assertNoAllocationsInRounds(getRandomGraph(200, 4, 20, 1011), "random");
+  assertNoAllocationsInRounds(getRecomputeGraph(getSqrtSeries(40)),
+                              "recompute");
+
+  // The searches for shifts which meet the cap, and which lower the max
+  // liveness, use the same workspaces
+  assertNoAllocationsInRounds(getRandomGraph(200, 4, 20, 1011),
+                              "random",
+                              LivenessObjective::SUM,
+                              true);
+  assertNoAllocationsInRounds(getRandomGraph(200, 4, 20, 1011),
+                              "random",
+                              LivenessObjective::MAX);
+
+  // An Alloc with a non-centre weight, so that AllocWeights rather than
+  // doubles are used in the ripple algorithm
+  auto g = getRandomGraph(200, 4, 20, 1013);
+  g.insertOpAlloc(0, g.insertAlloc(AllocWeight(1.0, -1)));
+  assertNoAllocationsInRounds(g, "random with lexicographic weights");
+
+  return 0;
+}
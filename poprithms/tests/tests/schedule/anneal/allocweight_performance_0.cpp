@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/allocweight.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/annealcommandlineoptions.hpp>
+#include <testutil/schedule/anneal/grid_generator.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// Motivation for vectorizing AllocWeight: compare the throughput of the
+// AllocWeight operators used in the ripple algorithm to a plain
+// std::array<double, NAW> implementation, and time the ripple algorithm on
+// Graphs where AllocWeights (as opposed to doubles) are required.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+using Reference = std::array<double, NAW>;
+
+template <typename T> void add(T &a, const T &b) { a += b; }
+template <> void add(Reference &a, const Reference &b) {
+  for (uint64_t i = 0; i < NAW; ++i) {
+    a[i] += b[i];
+  }
+}
+
+template <typename T> bool lessThan(const T &a, const T &b) { return a < b; }
+
+template <typename T>
+void benchmark(const std::vector<T> &ws,
+               uint64_t repeat,
+               const std::string &description) {
+  T sum = ws[0];
+  uint64_t nLess{0};
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint64_t r = 0; r < repeat; ++r) {
+    for (uint64_t i = 1; i < ws.size(); ++i) {
+      add(sum, ws[i]);
+      nLess += lessThan(ws[i - 1], ws[i]);
+    }
+  }
+  auto stop = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = stop - start;
+  // print nLess so that the loop is not optimized away
+  std::cout << description << " : "
+            << repeat * (ws.size() - 1) / elapsed.count()
+            << " (add + compare) per second, nLess = " << nLess << std::endl;
+}
+
+void anneal(Graph g, const std::string &description) {
+  // An Alloc with a non-centre weight forces AllocWeights to be used.
+  auto lexicoAlloc = g.insertAlloc(AllocWeight(1.0, -1));
+  g.insertOpAlloc(0, lexicoAlloc);
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  auto start = std::chrono::high_resolution_clock::now();
+  g.minSumLivenessAnneal({{"seed", "1012"}});
+  auto stop = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = stop - start;
+  std::cout << description << " : " << elapsed.count() << " [s]"
+            << std::endl;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+
+  auto opts = AnnealCommandLineOptions().getCommandLineOptionsMap(
+      argc,
+      argv,
+      {"repeat"},
+      {"Number of iterations to loop for in benchmarks"});
+  auto repeat = static_cast<uint64_t>(std::stoi(opts.at("repeat")));
+
+  // Weights which mostly agree in the leading lanes, so that the
+  // lexicographic comparisons do not exit early.
+  std::mt19937 gen(1011);
+  std::uniform_int_distribution<int> dis(0, 3);
+  std::vector<Reference> references(1000);
+  std::vector<AllocWeight> allocWeights;
+  for (auto &r : references) {
+    for (uint64_t i = 0; i < NAW; ++i) {
+      r[i] = i < NAW - 2 ? 1.0 : static_cast<double>(dis(gen));
+    }
+    allocWeights.push_back(AllocWeight(r));
+  }
+
+  std::cout << "AllocWeight operator throughput:" << std::endl;
+  benchmark(references, repeat, "std::array<double, NAW>");
+  benchmark(allocWeights, repeat, "AllocWeight");
+
+  std::cout << "\nRipple algorithm with AllocWeights:" << std::endl;
+  anneal(getRecomputeGraph(getSqrtSeries(100)), "recompute, N = 100");
+  anneal(getGridGraph0(12), "grid, N = 12");
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+// With a liveness cap, Kahn's algorithm prefers Ops which keep the liveness
+// at most the cap, minSumLivenessAnneal does not raise the liveness above
+// the cap, and an error is thrown if the cap cannot be met.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+AllocWeight getMaxLiveness(const Graph &g) {
+  auto maxLiveness = AllocWeight::zero();
+  for (ScheduleIndex i = 0; i < g.nOps_i32(); ++i) {
+    maxLiveness = std::max(maxLiveness, g.scheduleToLiveness(i));
+  }
+  return maxLiveness;
+}
+
+// A root Op, followed by nChains chains of 2 Ops, whose Ops share an Alloc.
+// Scheduling all of the first Ops of the chains before any of the second
+// Ops makes all of the Allocs live together.
+Graph getChains(uint64_t nChains) {
+  Graph g;
+  const auto root = g.insertOp("root");
+  for (uint64_t i = 0; i < nChains; ++i) {
+    const auto a = g.insertOp("a" + std::to_string(i));
+    const auto b = g.insertOp("b" + std::to_string(i));
+    g.insertConstraint(root, a);
+    g.insertConstraint(a, b);
+    g.insertOpAlloc({a, b}, g.insertAlloc(10.0));
+  }
+  return g;
+}
+
+void assertKahnMeetsCap() {
+  auto g0 = getChains(6);
+  g0.initialize(KahnTieBreaker::RANDOM, 1011);
+  if (!(AllocWeight(10.0) < getMaxLiveness(g0))) {
+    throw error("Expected Kahn's algorithm without a cap to interleave the "
+                "chains, otherwise this test is not testing the cap");
+  }
+
+  for (auto tieBreaker : {KahnTieBreaker::RANDOM,
+                          KahnTieBreaker::GREEDY,
+                          KahnTieBreaker::FIFO}) {
+    auto g = getChains(6);
+    g.setLivenessCap(10.0);
+    g.initialize(tieBreaker, 1011);
+    if (!g.getLivenessCapViolations().empty() || !g.isSchedulable()) {
+      std::ostringstream oss;
+      oss << "Expected Kahn's algorithm with a cap of 10 to schedule the "
+          << "chains one after another, not with a maximum liveness of "
+          << getMaxLiveness(g) << ", with the tie-breaker " << tieBreaker;
+      throw error(oss.str());
+    }
+  }
+}
+
+// Annealing from a schedule with a low maximum liveness, where annealing
+// without the cap raises it
+void assertAnnealMeetsCap() {
+  auto g0 = getRandomGraph(60, 3, 10, 1011);
+  g0.initialize(KahnTieBreaker::RANDOM, 1011);
+  g0.minSumLivenessAnneal({{"objective", "max"}});
+  const auto cap = getMaxLiveness(g0);
+
+  for (const auto &options : std::vector<std::map<std::string, std::string>>{
+           {},
+           {{"initialTemperature", "2"}},
+           {{"windowSize", "8"}},
+           {{"nTabuIterations", "50"}}}) {
+    auto uncapped = g0;
+    uncapped.minSumLivenessAnneal(options);
+
+    auto capped = g0;
+    capped.setLivenessCap(cap);
+    capped.minSumLivenessAnneal(options);
+
+    std::cout << "cap = " << cap
+              << " : without the cap, max = " << getMaxLiveness(uncapped)
+              << " and sum = " << uncapped.getSumLiveness()
+              << ", with the cap, max = " << getMaxLiveness(capped)
+              << " and sum = " << capped.getSumLiveness() << std::endl;
+
+    if (!capped.isSchedulable() ||
+        !capped.getLivenessCapViolations().empty()) {
+      throw error("Annealing with a cap which the initial schedule meets "
+                  "should give a valid schedule which meets it");
+    }
+    if (!(cap < getMaxLiveness(uncapped))) {
+      throw error("Expected annealing without the cap to exceed it, "
+                  "otherwise this test is not testing the cap");
+    }
+  }
+}
+
+// The window phase, starting from a schedule where the T=0 search has
+// converged, improves the sum liveness without exceeding the cap
+void assertWindowMeetsCap() {
+  auto g0 = getRandomGraph(100, 3, 10, 1011);
+  g0.initialize(KahnTieBreaker::RANDOM, 1011);
+  g0.minSumLivenessAnneal();
+  g0.setLivenessCap(getMaxLiveness(g0));
+
+  auto g = g0;
+  g.minSumLivenessAnneal({{"windowSize", "10"}});
+  if (!(g.getSumLiveness() < g0.getSumLiveness()) ||
+      !g.getLivenessCapViolations().empty()) {
+    std::ostringstream oss;
+    oss << "Expected the window phase to lower the sum liveness from "
+        << g0.getSumLiveness() << " while meeting the cap of "
+        << g0.getLivenessCap() << ", not to give a sum liveness of "
+        << g.getSumLiveness() << " and a max liveness of "
+        << getMaxLiveness(g);
+    throw error(oss.str());
+  }
+}
+
+// The Alloc of o0 and o3 has no Op in the window of y and x, but is live
+// throughout it. Swapping y and x lowers the sum liveness, but raises the
+// max liveness to 23, above the cap.
+void assertWindowCountsSpanningAllocs() {
+  Graph g;
+  const auto o0 = g.insertOp("o0");
+  const auto y  = g.insertOp("y");
+  const auto x  = g.insertOp("x");
+  const auto o3 = g.insertOp("o3");
+  g.insertConstraint(o0, y);
+  g.insertConstraint(o0, x);
+  g.insertConstraint(y, o3);
+  g.insertConstraint(x, o3);
+  g.insertOpAlloc({o0, o3}, g.insertAlloc(10.0));
+  g.insertOpAlloc({o0, x}, g.insertAlloc(2.0));
+  g.insertOpAlloc({o0, y}, g.insertAlloc(1.0));
+  g.insertOpAlloc(x, g.insertAlloc(10.0));
+  g.setLivenessCap(22.0);
+  g.initialize(std::vector<OpAddress>{o0, y, x, o3});
+  g.minSumLivenessAnneal({{"windowSize", "2"}});
+  if (!g.getLivenessCapViolations().empty()) {
+    throw error("The window phase should not exceed the cap, including "
+                "the liveness of Allocs which span the window");
+  }
+}
+
+void assertInfeasibleThrows() {
+  // Op b0 (the Op with address 2) has a liveness of at least 15 in every
+  // schedule, so a cap of 5 cannot be met
+  auto g = getChains(2);
+  g.insertOpAlloc(2, g.insertAlloc(5.0));
+  g.setLivenessCap(5.0);
+  g.initialize();
+  if (g.getLivenessCapViolations().empty()) {
+    throw error("Expected the cap of 5 to be violated");
+  }
+  bool caught{false};
+  try {
+    g.minSumLivenessAnneal();
+  } catch (const poprithms::util::error &e) {
+    caught                 = true;
+    const std::string what = e.what();
+    if (what.find("cannot be met") == std::string::npos ||
+        what.find("[") == std::string::npos) {
+      throw error("Expected the error to report the offending range, not " +
+                  what);
+    }
+  }
+  if (!caught) {
+    throw error("Expected an error for a cap which cannot be met");
+  }
+  if (!g.isSchedulable()) {
+    throw error("Expected a valid schedule after the error");
+  }
+
+  g.removeLivenessCap();
+  g.minSumLivenessAnneal();
+}
+} // namespace
+
+int main() {
+  assertKahnMeetsCap();
+  assertAnnealMeetsCap();
+  assertWindowMeetsCap();
+  assertWindowCountsSpanningAllocs();
+  assertInfeasibleThrows();
+  assertThrowsWhenInitialized(
+      [](Graph &g) {
+        g.setLivenessCap(1e6);
+        g.minSumLivenessAnneal(MinSumLivenessAlgo::SIMPLE);
+      },
+      "a cap with the SIMPLE algorithm");
+  return 0;
+}
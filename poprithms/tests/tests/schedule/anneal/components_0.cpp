@@ -0,0 +1,115 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <tuple>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// Annealing the connected components of a Graph independently must give a
+// valid schedule, in which each component is contiguous, and which does not
+// depend on the number of threads.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+// A Graph consisting of copies of the Graphs "parts", with no constraints or
+// Allocs between the copies
+Graph getDisjointUnion(const std::vector<Graph> &parts) {
+  Graph g;
+  for (const auto &part : parts) {
+    const auto opOffset    = g.nOps();
+    const auto allocOffset = g.nAllocs();
+    for (const auto &alloc : part.getAllocs()) {
+      g.insertAlloc(alloc.getWeight());
+    }
+    for (const auto &op : part.getOps()) {
+      g.insertOp(part.getDebugString(op.getAddress()));
+    }
+    for (const auto &op : part.getOps()) {
+      for (auto out : op.getOuts()) {
+        g.insertConstraint(opOffset + op.getAddress(), opOffset + out);
+      }
+      for (auto alloc : op.getAllocs()) {
+        g.insertOpAlloc(opOffset + op.getAddress(), allocOffset + alloc);
+      }
+    }
+  }
+  return g;
+}
+
+void assertComponents(const Graph &g0, const std::string &description) {
+
+  auto anneal = [&g0](uint32_t nThreads) {
+    auto g = g0;
+    g.initialize(KahnTieBreaker::RANDOM, 1011);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (nThreads == 0) {
+      g.minSumLivenessAnneal({{"seed", "1012"}});
+    } else {
+      g.minSumLivenessAnnealComponents(nThreads, {{"seed", "1012"}});
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    return std::make_tuple(std::move(g),
+                           std::chrono::duration<double>(t1 - t0).count());
+  };
+
+  const auto flat = anneal(0);
+  const auto one  = anneal(1);
+  const auto &g   = std::get<0>(one);
+
+  std::cout << description << " : " << g.getComponents().size()
+            << " components. flat " << std::get<1>(flat)
+            << " [s], sum liveness " << std::get<0>(flat).getSumLiveness()
+            << "\n components " << std::get<1>(one) << " [s], sum liveness "
+            << g.getSumLiveness() << std::endl;
+
+  g.assertCorrectness();
+
+  for (const auto &component : g.getComponents()) {
+    ScheduleIndex first = g.opToSchedule(component[0]);
+    ScheduleIndex final = first;
+    for (auto opAddress : component) {
+      first = std::min(first, g.opToSchedule(opAddress));
+      final = std::max(final, g.opToSchedule(opAddress));
+    }
+    if (static_cast<uint64_t>(final - first + 1) != component.size()) {
+      throw error("A component is not contiguous, for " + description);
+    }
+  }
+
+  if (std::get<0>(anneal(3)).getScheduleToOp() != g.getScheduleToOp()) {
+    throw error("Different schedules obtained with different numbers of "
+                "threads, for " +
+                description);
+  }
+}
+} // namespace
+
+int main() {
+
+  std::vector<Graph> parts;
+  for (uint32_t i = 0; i < 6; ++i) {
+    parts.push_back(getRandomGraph(50, 3, 15, 1011 + i));
+  }
+  parts.push_back(getRecomputeGraph(getSqrtSeries(30)));
+  const auto g = getDisjointUnion(parts);
+
+  uint64_t nExpected{0};
+  for (const auto &part : parts) {
+    nExpected += part.getComponents().size();
+  }
+  if (g.getComponents().size() != nExpected) {
+    throw error("Incorrect number of components in the disjoint union");
+  }
+  assertComponents(g, "disjoint union");
+
+  // a single component
+  assertComponents(getRandomGraph(60, 3, 15, 1017), "random");
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+// A Graph constructed in bulk with Graph::fromCompressedRows should be
+// identical to one grown incrementally.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertThrows(const std::function<void()> &f,
+                  const std::string &description) {
+  bool caught{false};
+  try {
+    f();
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error to be thrown for " + description);
+  }
+}
+
+} // namespace
+
+int main() {
+
+  auto g0 = getRandomGraph(300, 4, 30, 1011);
+  g0.finalize();
+
+  // Flatten g0 into CSR arrays, with each row shuffled and its first element
+  // repeated, as duplicates and unsorted rows are permitted.
+  std::mt19937 rng(1012);
+  std::vector<uint64_t> outOffsets{0};
+  std::vector<OpAddress> outs;
+  std::vector<uint64_t> allocOffsets{0};
+  std::vector<AllocAddress> allocs;
+  std::vector<std::string> names;
+  auto appendRow = [&rng](std::vector<uint64_t> row,
+                          std::vector<uint64_t> &targets,
+                          std::vector<uint64_t> &offsets) {
+    std::shuffle(row.begin(), row.end(), rng);
+    if (!row.empty()) {
+      row.push_back(row[0]);
+    }
+    targets.insert(targets.end(), row.cbegin(), row.cend());
+    offsets.push_back(targets.size());
+  };
+  for (const auto &op : g0.getOps()) {
+    appendRow(op.getOuts(), outs, outOffsets);
+    appendRow(op.getAllocs(), allocs, allocOffsets);
+    names.push_back(g0.getDebugString(op.getAddress()));
+  }
+  std::vector<AllocWeight> weights;
+  for (const auto &alloc : g0.getAllocs()) {
+    weights.push_back(alloc.getWeight());
+  }
+
+  auto g1 = Graph::fromCompressedRows(
+      outOffsets, outs, allocOffsets, allocs, weights, names);
+  if (g1 != g0) {
+    throw error("Graph constructed from compressed rows differs from the "
+                "Graph grown incrementally");
+  }
+
+  g0.initialize();
+  g1.initialize();
+  if (g0.getScheduleToOp() != g1.getScheduleToOp()) {
+    throw error("Expected identical Graphs to have identical schedules");
+  }
+
+  // Without names, all Ops have empty debug strings.
+  auto g2 = Graph::fromCompressedRows(
+      outOffsets, outs, allocOffsets, allocs, weights);
+  if (g2.nOps() != g0.nOps() || !g2.getDebugString(0).empty()) {
+    throw error("Unexpected Graph constructed without Op names");
+  }
+
+  // Two Ops, 0 -> 1, sharing Alloc 0.
+  const std::vector<uint64_t> offs{0, 1, 1};
+  const std::vector<AllocWeight> w{AllocWeight(1.0)};
+  assertThrows(
+      [&]() { Graph::fromCompressedRows({0, 1}, {0}, {0, 0, 0}, {}, w); },
+      "too few allocOffsets");
+  assertThrows(
+      [&]() { Graph::fromCompressedRows({0, 1, 2}, {1}, offs, {0}, w); },
+      "offsets which do not end at the number of targets");
+  assertThrows(
+      [&]() { Graph::fromCompressedRows({0, 2, 1}, {1}, offs, {0}, w); },
+      "decreasing offsets");
+  assertThrows(
+      [&]() { Graph::fromCompressedRows(offs, {2}, offs, {0}, w); },
+      "an out of range Op");
+  assertThrows(
+      [&]() { Graph::fromCompressedRows(offs, {1}, offs, {1}, w); },
+      "an out of range Alloc");
+  assertThrows(
+      [&]() { Graph::fromCompressedRows(offs, {1}, offs, {0}, w, {"a"}); },
+      "too few names");
+  Graph::fromCompressedRows(offs, {1}, offs, {0}, w, {"a", "b"});
+
+  return 0;
+}
@@ -34,6 +34,16 @@ void test0() {
     throw error("Expected 4 Ops in merged Graph");
   }
 
+  if (g0.getDebugString(0) != "(op1 op3)") {
+    throw error("Expected child Op names to concatenate parent Op names");
+  }
+
+  auto unnamed = std::get<0>(g.getMerged({{1, 3}, {2, 4}}, false));
+  if (!unnamed.getDebugString(0).empty() ||
+      unnamed.getDebugStrings().size() != 1) {
+    throw error("Expected no debug strings in merged Graph without names");
+  }
+
   auto linkMerged0 = g.getLinkMerged();
   if (std::get<0>(linkMerged0).nOps() != g.nOps()) {
     throw error(
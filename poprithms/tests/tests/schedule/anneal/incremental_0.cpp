@@ -0,0 +1,188 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+template <typename F> void assertThrows(F &&f, const std::string &what) {
+  bool caught{false};
+  try {
+    f();
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error to be thrown, " + what);
+  }
+}
+
+double seconds(const std::chrono::high_resolution_clock::time_point &t0) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::high_resolution_clock::now() - t0;
+  return elapsed.count();
+}
+
+void testRandomEdits() {
+
+  auto g = getRandomGraph(300, 4, 30, 1011);
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  g.minSumLivenessAnneal({{"seed", "1012"}});
+
+  // Insert "cast" Ops between some producers and their consumers.
+  for (OpAddress producer : {10, 50, 100, 200}) {
+    if (g.getOp(producer).nOuts() == 0) {
+      continue;
+    }
+    const auto consumer = g.getOp(producer).getOut(0);
+    const auto cast     = g.insertOp("cast" + std::to_string(producer));
+    g.insertConstraint(producer, cast);
+    g.insertConstraint(cast, consumer);
+    g.insertOpAlloc({producer, cast}, g.insertAlloc(3.0));
+    g.insertOpAlloc({cast, consumer}, g.insertAlloc(3.0));
+  }
+
+  // Remove an Op, an Alloc, and a constraint.
+  g.removeOp(150);
+  g.removeAlloc(7);
+  const auto before = static_cast<OpAddress>(120);
+  if (g.getOp(before).nOuts() != 0) {
+    g.removeConstraint(before, g.getOp(before).getOut(0));
+  }
+
+  if (!g.hasPendingEdits()) {
+    throw error("Expected pending edits");
+  }
+  assertThrows([&g]() { g.minSumLivenessAnneal({}); },
+               "annealing with pending edits");
+
+  auto full = g;
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  g.updateSchedule({{"seed", "1013"}});
+  const auto incrementalTime = seconds(t0);
+
+  g.assertCorrectness();
+  if (!g.isSchedulable() || g.hasPendingEdits()) {
+    throw error("Invalid state after updateSchedule");
+  }
+  if (g.getOp(150).nIns() != 0 || g.getOp(150).nOuts() != 0 ||
+      g.getOp(150).nAllocs() != 0 || g.getAlloc(7).nOps() != 0) {
+    throw error("Removed Op or Alloc still connected");
+  }
+
+  t0 = std::chrono::high_resolution_clock::now();
+  full.initialize(KahnTieBreaker::RANDOM, 1011);
+  full.minSumLivenessAnneal({{"seed", "1013"}});
+  const auto fullTime = seconds(t0);
+
+  std::cout << "incremental : " << incrementalTime << " [s], sum liveness "
+            << g.getSumLiveness() << "\nfull        : " << fullTime
+            << " [s], sum liveness " << full.getSumLiveness() << std::endl;
+}
+
+void testReordering() {
+
+  // a -> b, c is free. A constraint which contradicts the current schedule
+  // requires the spliced schedule to reorder Ops.
+  Graph g;
+  auto a = g.insertOp("a");
+  auto b = g.insertOp("b");
+  auto c = g.insertOp("c");
+  g.insertConstraint(a, b);
+  g.initialize({a, b, c});
+
+  g.insertConstraint(c, a);
+  auto d = g.insertOp("d");
+  auto e = g.insertOp("e");
+  g.insertLink(d, e);
+  g.insertConstraint(b, d);
+  g.updateSchedule({});
+  g.assertCorrectness();
+  if (g.getScheduleToOp() != std::vector<OpAddress>{c, a, b, d, e}) {
+    throw error("Unexpected schedule after reordering");
+  }
+
+  assertThrows([&g, d, e]() { g.removeConstraint(d, e); },
+               "removing a link constraint");
+  assertThrows([&g, a, e]() { g.removeConstraint(a, e); },
+               "removing a non-existent constraint");
+
+  // removing d removes the link, after which e is free
+  g.removeOp(d);
+  g.updateSchedule({});
+  g.assertCorrectness();
+  if (g.getOp(e).hasBackwardLink()) {
+    throw error("Link not removed with Op");
+  }
+}
+// The TransitiveClosureOptimizations remove a -> c as redundant and link a
+// to b, so the constraints of the chain cannot be removed by the user
+void testTransitiveClosureOptimized() {
+  auto getChain = []() {
+    Graph g;
+    const auto ops = g.insertOps({"a", "b", "c"});
+    g.insertConstraint(ops[0], ops[1]);
+    g.insertConstraint(ops[1], ops[2]);
+    g.insertConstraint(ops[0], ops[2]);
+    g.insertOpAlloc({ops[0], ops[1]}, g.insertAlloc(1.0));
+    return g;
+  };
+  const OpAddress a = 0;
+  const OpAddress b = 1;
+  const OpAddress c = 2;
+
+  auto g = getChain();
+  g.initialize(KahnTieBreaker::GREEDY,
+               1011,
+               TransitiveClosureOptimizations::allOn());
+  auto assertNotEditable = [](const std::function<void()> &f,
+                             const std::string &what) {
+    std::string message;
+    try {
+      f();
+    } catch (const poprithms::util::error &e) {
+      message = e.what();
+    }
+    if (message.find("TransitiveClosureOptimizations") == std::string::npos) {
+      throw error("Expected the Graph to not be editable after "
+                  "TransitiveClosureOptimizations, when " +
+                  what + ", not \"" + message + "\"");
+    }
+  };
+  assertNotEditable([&g, a, c]() { g.removeConstraint(a, c); },
+                    "removing a redundant constraint");
+  assertNotEditable([&g, a, b]() { g.removeConstraint(a, b); },
+                    "removing a constraint which is now a link");
+  assertNotEditable([&g]() { g.insertOp("d"); }, "inserting an Op");
+  assertNotEditable([&g, c]() { g.removeOp(c); }, "removing an Op");
+
+  // nor after initializing again without them, as the Graph keeps the
+  // constraints and links which they inserted
+  g.initialize();
+  assertNotEditable([&g, a, c]() { g.insertConstraint(c, a); },
+                    "inserting a constraint after initializing again");
+
+  // without them, the Graph can be edited
+  auto edited = getChain();
+  edited.initialize();
+  edited.removeConstraint(a, c);
+  edited.removeConstraint(a, b);
+  edited.updateSchedule({});
+  edited.assertCorrectness();
+}
+} // namespace
+
+int main() {
+  testRandomEdits();
+  testReordering();
+  testTransitiveClosureOptimized();
+  return 0;
+}
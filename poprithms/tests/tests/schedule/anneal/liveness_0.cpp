@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// The liveness is updated with every change to the schedule. With debug,
+// it is compared to the liveness computed from scratch after every change.
+// Here we also check it against the liveness computed from the Alloc
+// intervals, between annealing runs with small swap limits.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertLiveness(const Graph &g, const std::string &description) {
+  std::vector<AllocWeight> expected(g.nOps() + 1, AllocWeight::zero());
+  for (const auto &alloc : g.getAllocs()) {
+    if (alloc.nOps() == 0) {
+      continue;
+    }
+    for (auto i = g.allocToFirstSchedule(alloc.getAddress());
+         i <= g.allocToFinalSchedule(alloc.getAddress());
+         ++i) {
+      expected[static_cast<uint64_t>(i)] += alloc.getWeight();
+    }
+  }
+
+  AllocWeight expectedSum{0};
+  AllocWeight expectedMax{0};
+  for (uint64_t i = 0; i < expected.size(); ++i) {
+    if (g.scheduleToLiveness(static_cast<ScheduleIndex>(i)) != expected[i]) {
+      throw error("Incorrect liveness at schedule index " +
+                  std::to_string(i) + ", for " + description);
+    }
+    expectedSum += expected[i];
+    expectedMax = std::max(expectedMax, expected[i]);
+  }
+  if (g.getSumLiveness() != expectedSum) {
+    throw error("Incorrect sum liveness, for " + description);
+  }
+  if (g.getMaxLiveness() != expectedMax) {
+    throw error("Incorrect max liveness, for " + description);
+  }
+}
+
+void assertIncrementalLiveness(Graph g, const std::string &description) {
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  assertLiveness(g, description);
+  for (uint32_t seed = 0; seed < 5; ++seed) {
+    g.minSumLivenessAnneal({{"debug", "1"},
+                            {"seed", std::to_string(seed)},
+                            {"swapLimitCount", "7"}});
+    assertLiveness(g, description);
+  }
+}
+} // namespace
+
+int main() {
+
+  assertIncrementalLiveness(getRandomGraph(40, 3, 10, 1011), "random");
+  assertIncrementalLiveness(getRecomputeGraph(getSqrtSeries(20)),
+                            "recompute");
+
+  // with weights outside of the centre lexicographic position
+  auto g = getRandomGraph(30, 3, 10, 1012);
+  for (OpAddress a = 0; a < g.nOps(); a += 3) {
+    g.insertOpAlloc(a, g.insertAlloc(AllocWeight(1.0, -1)));
+  }
+  assertIncrementalLiveness(g, "lexicographic");
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+// getSumLivenessLowerBound must not exceed the sum liveness of any valid
+// schedule, which is confirmed by enumerating all schedules of small Graphs.
+// Annealing with targetGapPercent stops once the sum liveness is within the
+// target of the bound.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+AllocWeight getSumLiveness(const Graph &g,
+                           const std::vector<OpAddress> &schedule) {
+  std::vector<uint64_t> opToSchedule(g.nOps());
+  for (uint64_t i = 0; i < schedule.size(); ++i) {
+    opToSchedule[schedule[i]] = i;
+  }
+  AllocWeight sum = AllocWeight::zero();
+  for (const auto &alloc : g.getAllocs()) {
+    if (alloc.nOps() == 0) {
+      continue;
+    }
+    uint64_t first = g.nOps();
+    uint64_t final{0};
+    for (auto opAddress : alloc.getOps()) {
+      first = std::min(first, opToSchedule[opAddress]);
+      final = std::max(final, opToSchedule[opAddress]);
+    }
+    sum += static_cast<int64_t>(final - first + 1) * alloc.getWeight();
+  }
+  return sum;
+}
+
+// The lowest sum liveness of all schedules, by depth-first enumeration
+void getMinSumLiveness(const Graph &g,
+                       std::vector<uint64_t> &nOutstanding,
+                       std::vector<OpAddress> &schedule,
+                       AllocWeight &best) {
+  if (schedule.size() == g.nOps()) {
+    best = std::min(best, getSumLiveness(g, schedule));
+    return;
+  }
+  for (OpAddress a = 0; a < g.nOps(); ++a) {
+    if (nOutstanding[a] != 0) {
+      continue;
+    }
+    nOutstanding[a] = g.nOps();
+    for (auto out : g.getOp(a).getOuts()) {
+      --nOutstanding[out];
+    }
+    schedule.push_back(a);
+    getMinSumLiveness(g, nOutstanding, schedule, best);
+    schedule.pop_back();
+    for (auto out : g.getOp(a).getOuts()) {
+      ++nOutstanding[out];
+    }
+    nOutstanding[a] = 0;
+  }
+}
+
+AllocWeight getMinSumLiveness(const Graph &g) {
+  std::vector<uint64_t> nOutstanding;
+  for (const auto &op : g.getOps()) {
+    nOutstanding.push_back(op.nIns());
+  }
+  std::vector<OpAddress> schedule;
+  auto best = AllocWeight::numericMaxLimit();
+  getMinSumLiveness(g, nOutstanding, schedule, best);
+  return best;
+}
+
+void assertBelowMinimum(uint64_t nOps, int seed) {
+  auto g0 = getRandomGraph(nOps, 2, 4, seed);
+  g0.finalize();
+
+  // Without and with the TransitiveClosure built by initialize, whose
+  // optimizations insert constraints, and so may raise the minimum
+  auto g1 = g0;
+  g1.initialize(KahnTieBreaker::RANDOM,
+                1011,
+                TransitiveClosureOptimizations::allOn());
+  for (const auto &g : {g0, g1}) {
+    const auto minimum    = getMinSumLiveness(g);
+    const auto lowerBound = g.getSumLivenessLowerBound();
+    if (minimum < lowerBound) {
+      std::ostringstream oss;
+      oss << "The lower bound " << lowerBound
+          << " exceeds the minimum sum liveness " << minimum
+          << ", for the random Graph with seed " << seed;
+      throw error(oss.str());
+    }
+  }
+}
+
+// All schedules of a chain have the same sum liveness, which is the bound
+void assertChainTight() {
+  Graph g;
+  const auto ops = g.insertOps({"a", "b", "c", "d"});
+  for (uint64_t i = 1; i < ops.size(); ++i) {
+    g.insertConstraint(ops[i - 1], ops[i]);
+  }
+  g.insertOpAlloc({ops[0], ops[2]}, g.insertAlloc(2.0));
+  g.insertOpAlloc({ops[1], ops[3]}, g.insertAlloc(3.0));
+  g.insertOpAlloc(ops[3], g.insertAlloc(5.0));
+  g.initialize();
+  if (g.getSumLivenessLowerBound() != g.getSumLiveness()) {
+    std::ostringstream oss;
+    oss << "Expected the lower bound of a chain to be its sum liveness, "
+        << g.getSumLiveness() << ", not " << g.getSumLivenessLowerBound();
+    throw error(oss.str());
+  }
+}
+
+// Initializing again, after an edit, builds the TransitiveClosure afresh
+void assertBelowAfterReinitialize(int seed) {
+  auto g = getRandomGraph(60, 3, 10, seed);
+  g.initialize();
+  const auto op = g.insertOp("late");
+  g.insertConstraint(0, op);
+  g.initialize(KahnTieBreaker::GREEDY,
+               1011,
+               TransitiveClosureOptimizations::allOn());
+  if (g.getSumLiveness() < g.getSumLivenessLowerBound()) {
+    std::ostringstream oss;
+    oss << "The lower bound " << g.getSumLivenessLowerBound()
+        << " exceeds the sum liveness " << g.getSumLiveness()
+        << " after initializing again, for the random Graph with seed "
+        << seed;
+    throw error(oss.str());
+  }
+}
+
+void assertStopsAtGap() {
+  auto g0 = getRandomGraph(100, 4, 20, 1011);
+  g0.initialize(KahnTieBreaker::RANDOM, 1011);
+  const auto lowerBound = g0.getSumLivenessLowerBound();
+
+  auto anneal = [&g0](const std::string &targetGapPercent) {
+    auto g = g0;
+    g.minSumLivenessAnneal({{"targetGapPercent", targetGapPercent}});
+    return g;
+  };
+
+  const auto full = anneal("-1");
+  if (full.getSumLiveness() < lowerBound) {
+    throw error("Annealing found a schedule below the lower bound");
+  }
+
+  // The initial schedule is already within a gap of 1e6 percent
+  const auto initial = anneal("1e6");
+  if (initial.getScheduleToOp() != g0.getScheduleToOp()) {
+    throw error("Expected no annealing, as the initial schedule is within "
+                "the target gap");
+  }
+
+  // A target gap between those of the initial and the fully annealed
+  // schedules, so annealing stops between them
+  auto getGap = [&lowerBound](const Graph &g) {
+    return 100.0 * getL1(g.getSumLiveness() - lowerBound) /
+           getL1(lowerBound);
+  };
+  const auto targetGap = 0.5 * (getGap(g0) + getGap(full));
+  const auto early     = anneal(std::to_string(targetGap));
+  if (early.getSumLiveness() <= full.getSumLiveness() ||
+      g0.getSumLiveness() <= early.getSumLiveness() ||
+      targetGap < getGap(early)) {
+    std::ostringstream oss;
+    oss << "Expected stopping at a gap of " << targetGap
+        << " percent to give a sum liveness between the initial "
+        << g0.getSumLiveness() << " and the full " << full.getSumLiveness()
+        << ", not " << early.getSumLiveness();
+    throw error(oss.str());
+  }
+  std::cout << "initial = " << g0.getSumLiveness()
+            << ", stopped at gap = " << early.getSumLiveness()
+            << ", full = " << full.getSumLiveness()
+            << ", lower bound = " << lowerBound << std::endl;
+}
+} // namespace
+
+int main() {
+  for (int seed = 0; seed < 20; ++seed) {
+    assertBelowMinimum(8, seed);
+  }
+  assertChainTight();
+  for (int seed = 0; seed < 5; ++seed) {
+    assertBelowAfterReinitialize(seed);
+  }
+  assertStopsAtGap();
+  assertAnnealThrows({{"targetGapPercent", "5"}, {"objective", "max"}},
+                     "targetGapPercent with the Max objective");
+  return 0;
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <tuple>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/grid_generator.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// Multilevel annealing must give a valid schedule, deterministically, and
+// must respect links. The time and final sum liveness are compared to those
+// of annealing the Graph directly.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertMultilevel(const Graph &g0,
+                      uint64_t coarsestNOps,
+                      const std::string &description) {
+
+  // returns the annealed Graph and the time taken to anneal it
+  auto anneal = [&g0](uint64_t coarsest) {
+    auto g = g0;
+    g.initialize();
+    auto t0 = std::chrono::high_resolution_clock::now();
+    if (coarsest == 0) {
+      g.minSumLivenessAnneal({{"seed", "1012"}});
+    } else {
+      g.minSumLivenessAnnealMultilevel(coarsest, {{"seed", "1012"}});
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    return std::make_tuple(std::move(g),
+                           std::chrono::duration<double>(t1 - t0).count());
+  };
+
+  const auto flat       = anneal(0);
+  const auto multilevel = anneal(coarsestNOps);
+  const auto &g         = std::get<0>(multilevel);
+
+  std::cout << description << " : flat " << std::get<1>(flat)
+            << " [s], sum liveness " << std::get<0>(flat).getSumLiveness()
+            << "\n multilevel " << std::get<1>(multilevel)
+            << " [s], sum liveness " << g.getSumLiveness() << std::endl;
+
+  g.assertCorrectness();
+
+  if (std::get<0>(anneal(coarsestNOps)).getScheduleToOp() !=
+      g.getScheduleToOp()) {
+    throw error("Multilevel annealing is not deterministic, for " +
+                description);
+  }
+}
+
+// Link all tight pairs of a Graph
+Graph getLinked(Graph g) {
+  for (const auto &pair : g.getTightPairs()) {
+    g.insertLink(pair[0], pair[1]);
+  }
+  return g;
+}
+} // namespace
+
+int main() {
+
+  assertMultilevel(getRandomGraph(300, 4, 30, 1011), 20, "random");
+  assertMultilevel(getRecomputeGraph(getSqrtSeries(100)), 20, "recompute");
+  assertMultilevel(getGridGraph0(10), 20, "grid");
+  assertMultilevel(
+      getLinked(getRandomGraph(200, 3, 20, 1012)), 20, "random with links");
+
+  // No coarsening is possible below 2 Ops
+  assertMultilevel(getRandomGraph(50, 3, 10, 1013), 1, "random, coarsest");
+
+  return 0;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/grid_generator.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// The search for shifts is distributed across threads, but the final
+// schedule should be identical to that obtained with a single thread.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertSameForAllThreadCounts(const Graph &g0,
+                                  const std::string &description) {
+
+  for (bool filterSusceptible : {false, true}) {
+    std::vector<std::vector<OpAddress>> schedules;
+    for (uint32_t nThreads : {1, 2, 3, 5}) {
+      auto g = g0;
+      g.initialize(KahnTieBreaker::RANDOM, 1011);
+      g.minSumLivenessAnneal(MinSumLivenessAlgo::RIPPLE,
+                             Graph::defaultDebug(),
+                             1012,
+                             filterSusceptible,
+                             Graph::defaultTimeLimitSeconds(),
+                             Graph::defaultSwapLimitCount(),
+                             nThreads);
+      schedules.push_back(g.getScheduleToOp());
+    }
+    for (const auto &schedule : schedules) {
+      if (schedule != schedules[0]) {
+        std::ostringstream oss;
+        oss << "Different schedules obtained with different numbers of "
+            << "threads for " << description
+            << ", with filterSusceptible = " << filterSusceptible << '.';
+        throw error(oss.str());
+      }
+    }
+  }
+}
+} // namespace
+
+int main() {
+
+  assertSameForAllThreadCounts(getRandomGraph(100, 5, 20, 1011), "random");
+  assertSameForAllThreadCounts(getRecomputeGraph(getSqrtSeries(40)),
+                               "recompute");
+  assertSameForAllThreadCounts(getGridGraph0(6), "grid");
+
+  // with debug, the ripple algorithm is compared to the simple algorithm on
+  // every thread
+  auto g = getRandomGraph(40, 3, 10, 1013);
+  g.initialize();
+  g.minSumLivenessAnneal({{"debug", "1"}, {"nThreads", "3"}});
+
+  assertAnnealThrows({{"nThreads", "0"}}, "nThreads of 0");
+
+  return 0;
+}
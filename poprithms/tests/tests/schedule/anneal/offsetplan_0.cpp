@@ -0,0 +1,175 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <poprithms/schedule/anneal/offsetplan.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+// getOffsetPlan places Allocs which are live at the same time without
+// overlap, with a peak between the max liveness and the peak of first fit.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+bool liveTogether(const Graph &g, AllocAddress a, AllocAddress b) {
+  return g.allocToFirstSchedule(a) <= g.allocToFinalSchedule(b) &&
+         g.allocToFirstSchedule(b) <= g.allocToFinalSchedule(a);
+}
+
+double getSize(const Graph &g, AllocAddress a) {
+  return g.getAlloc(a).getWeight().getCentre();
+}
+
+void assertValid(const Graph &g, const OffsetPlan &plan) {
+  std::vector<double> peaks(g.nResourceClasses(), 0.0);
+  for (const auto &alloc0 : g.getAllocs()) {
+    const auto a = alloc0.getAddress();
+    if (alloc0.nOps() == 0) {
+      continue;
+    }
+    const auto r = alloc0.getResourceClass();
+    peaks[r]     = std::max(peaks[r], plan.offsets[a] + getSize(g, a));
+    if (plan.offsets[a] < 0.0) {
+      throw error("Expected non-negative offsets");
+    }
+    for (const auto &alloc1 : g.getAllocs()) {
+      const auto b = alloc1.getAddress();
+      if (b <= a || alloc1.nOps() == 0 || alloc1.getResourceClass() != r ||
+          !liveTogether(g, a, b)) {
+        continue;
+      }
+      if (plan.offsets[a] < plan.offsets[b] + getSize(g, b) &&
+          plan.offsets[b] < plan.offsets[a] + getSize(g, a)) {
+        std::ostringstream oss;
+        oss << "The Allocs " << a << " and " << b
+            << " are live at the same time, and overlap";
+        throw error(oss.str());
+      }
+    }
+  }
+  if (peaks != plan.peaks) {
+    throw error("Expected the peaks to be the highest ends of the Allocs");
+  }
+  for (ResourceClass r = 0; r < g.nResourceClasses(); ++r) {
+    if (plan.peaks[r] < g.getMaxLiveness(r).getCentre()) {
+      throw error("Expected the peak to be at least the max liveness");
+    }
+  }
+}
+
+// The peak of placing each Alloc at the lowest offset where it fits, in
+// order of the schedule index at which it becomes live
+double getFirstFitPeak(const Graph &g) {
+  std::vector<AllocAddress> order;
+  for (const auto &alloc : g.getAllocs()) {
+    if (alloc.nOps() > 0) {
+      order.push_back(alloc.getAddress());
+    }
+  }
+  std::sort(order.begin(), order.end(), [&g](AllocAddress a, AllocAddress b) {
+    return g.allocToFirstSchedule(a) < g.allocToFirstSchedule(b);
+  });
+  std::vector<double> offsets(g.nAllocs(), 0.0);
+  double peak{0.0};
+  for (uint64_t p = 0; p < order.size(); ++p) {
+    const auto a = order[p];
+    std::vector<AllocAddress> placed;
+    for (uint64_t q = 0; q < p; ++q) {
+      if (liveTogether(g, a, order[q])) {
+        placed.push_back(order[q]);
+      }
+    }
+    std::sort(placed.begin(),
+              placed.end(),
+              [&offsets](AllocAddress x, AllocAddress y) {
+                return offsets[x] < offsets[y];
+              });
+    double top{0.0};
+    for (auto b : placed) {
+      if (offsets[b] - top >= getSize(g, a)) {
+        break;
+      }
+      top = std::max(top, offsets[b] + getSize(g, b));
+    }
+    offsets[a] = top;
+    peak       = std::max(peak, top + getSize(g, a));
+  }
+  return peak;
+}
+
+void assertRandom(uint64_t nOps, int seed) {
+  auto g = getRandomGraph(nOps, 3, 20, seed);
+  g.initialize(KahnTieBreaker::RANDOM, seed);
+  g.minSumLivenessAnneal();
+
+  const auto bestFit = getOffsetPlan(g, 0);
+  const auto refined = getOffsetPlan(g);
+  assertValid(g, bestFit);
+  assertValid(g, refined);
+
+  const auto firstFit = getFirstFitPeak(g);
+  std::cout << nOps << " Ops : max liveness = " << g.getMaxLiveness()
+            << ", first fit = " << firstFit
+            << ", best fit = " << bestFit.peaks[0]
+            << ", with local search = " << refined.peaks[0] << std::endl;
+
+  if (bestFit.peaks[0] < refined.peaks[0]) {
+    throw error("The local search should not increase the peak");
+  }
+  if (firstFit < refined.peaks[0]) {
+    throw error("Expected a peak no higher than that of first fit");
+  }
+}
+
+// Allocs of the same size, where the peak is the max liveness
+void assertTight() {
+  Graph g;
+  const auto ops = g.insertOps({"a", "b", "c", "d", "e"});
+  for (uint64_t i = 1; i < ops.size(); ++i) {
+    g.insertConstraint(ops[i - 1], ops[i]);
+  }
+  g.insertOpAlloc({ops[0], ops[1]}, g.insertAlloc(4.0));
+  g.insertOpAlloc({ops[1], ops[2]}, g.insertAlloc(4.0));
+  g.insertOpAlloc({ops[2], ops[3]}, g.insertAlloc(4.0));
+  g.insertOpAlloc({ops[3], ops[4]}, g.insertAlloc(4.0));
+  g.insertOpAlloc({ops[0], ops[4]}, g.insertAlloc(4.0));
+  // In another resource, so planned separately
+  g.insertOpAlloc({ops[0], ops[4]}, g.insertAlloc(7.0, 1));
+  g.initialize();
+  const auto plan = getOffsetPlan(g);
+  assertValid(g, plan);
+  if (plan.peaks != std::vector<double>{12.0, 7.0}) {
+    std::ostringstream oss;
+    oss << "Expected peaks of 12 and 7, not " << plan.peaks[0] << " and "
+        << plan.peaks[1];
+    throw error(oss.str());
+  }
+}
+
+void assertThrows() {
+  auto g = getRandomGraph(10, 2, 4, 1011);
+  bool caught{false};
+  try {
+    getOffsetPlan(g);
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error for a Graph which is not initialized");
+  }
+}
+} // namespace
+
+int main() {
+  assertRandom(100, 1011);
+  assertRandom(1000, 1012);
+  assertTight();
+  assertThrows();
+  return 0;
+}
@@ -32,7 +32,8 @@ int main() {
     }
   }
 
-  Op op0(1000, "standaloneOp");
+  poprithms::util::StringPool debugStrings;
+  Op op0(1000, debugStrings.intern("standaloneOp"));
   op0.insertIn(1);
   op0.insertIn(3);
   op0.insertIn(2);
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/grid_generator.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// The Max and Hybrid objectives only apply shifts which improve them, and so
+// the final max liveness with the Max objective cannot exceed the initial max
+// liveness. Check this, and that the schedules are valid and deterministic.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertPeakObjectives(const Graph &g0, const std::string &description) {
+
+  auto anneal = [&g0](const std::string &objective) {
+    auto g = g0;
+    g.initialize(KahnTieBreaker::RANDOM, 1011);
+    g.minSumLivenessAnneal(
+        {{"seed", "1012"}, {"objective", objective}, {"maxWeight", "10"}});
+    if (!g.isSchedulable()) {
+      throw error("Invalid schedule with the " + objective + " objective");
+    }
+    return g;
+  };
+
+  auto initial = g0;
+  initial.initialize(KahnTieBreaker::RANDOM, 1011);
+
+  const auto sum    = anneal("sum");
+  const auto max    = anneal("max");
+  const auto hybrid = anneal("hybrid");
+
+  std::cout << description << " : max liveness initial = "
+            << initial.getMaxLiveness() << ", sum = " << sum.getMaxLiveness()
+            << ", max = " << max.getMaxLiveness()
+            << ", hybrid = " << hybrid.getMaxLiveness() << std::endl;
+
+  if (initial.getMaxLiveness() < max.getMaxLiveness()) {
+    throw error("The Max objective increased max liveness, for " +
+                description);
+  }
+
+  if (max.getMaxLiveness() == initial.getMaxLiveness() &&
+      initial.getSumLiveness() < max.getSumLiveness()) {
+    throw error("The Max objective increased sum liveness without "
+                "decreasing max liveness, for " +
+                description);
+  }
+
+  if (anneal("max").getScheduleToOp() != max.getScheduleToOp() ||
+      anneal("hybrid").getScheduleToOp() != hybrid.getScheduleToOp()) {
+    throw error("Peak annealing is not deterministic, for " + description);
+  }
+}
+} // namespace
+
+int main() {
+
+  assertPeakObjectives(getRandomGraph(100, 5, 20, 1011), "random");
+  assertPeakObjectives(getRecomputeGraph(getSqrtSeries(40)), "recompute");
+  assertPeakObjectives(getGridGraph0(6), "grid");
+
+  // with debug, the SegmentTree is compared to the liveness after every
+  // applied shift
+  for (auto objective : {"max", "hybrid"}) {
+    auto g = getRandomGraph(40, 3, 10, 1013);
+    g.initialize();
+    g.minSumLivenessAnneal(
+        {{"debug", "1"}, {"objective", objective}, {"nThreads", "3"}});
+  }
+
+  assertAnnealThrows({{"objective", "hybrid"}, {"maxWeight", "-1"}},
+                     "a negative maxWeight");
+
+  return 0;
+}
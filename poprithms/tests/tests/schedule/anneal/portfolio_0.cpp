@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// Multi-start annealing should install the best of the schedules obtained by
+// running each start individually, independent of the number of threads.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertBestOfStarts(const Graph &g0, const std::string &description) {
+
+  constexpr uint64_t nStarts{7};
+  constexpr uint32_t seed{1011};
+
+  AllocWeight bestLiveness = AllocWeight::numericMaxLimit();
+  for (uint64_t start = 0; start < nStarts; ++start) {
+    const auto startSeed = seed + static_cast<uint32_t>(start);
+    auto g               = g0;
+    g.initialize(static_cast<KahnTieBreaker>(start % NKahnTieBreakers),
+                 startSeed);
+    g.minSumLivenessAnneal(
+        {{"seed", std::to_string(startSeed)}, {"filterSusceptible", "0"}});
+    bestLiveness = std::min(bestLiveness, g.getSumLiveness());
+  }
+
+  std::vector<std::vector<OpAddress>> schedules;
+  for (uint32_t nThreads : {1, 3}) {
+    auto g = g0;
+    g.initialize();
+    g.minSumLivenessAnnealPortfolio(nStarts,
+                                    nThreads,
+                                    seed,
+                                    Graph::defaultTimeLimitSeconds(),
+                                    {{"filterSusceptible", "0"}});
+    g.assertCorrectness();
+    if (g.getSumLiveness() != bestLiveness) {
+      std::ostringstream oss;
+      oss << "Expected the best sum liveness of the starts, "
+          << bestLiveness << ", for " << description << ", not "
+          << g.getSumLiveness() << '.';
+      throw error(oss.str());
+    }
+    schedules.push_back(g.getScheduleToOp());
+  }
+  if (schedules[0] != schedules[1]) {
+    throw error("Portfolio schedule depends on the number of threads, for " +
+                description);
+  }
+}
+
+void assertThrows(bool initialize,
+                  uint64_t nStarts,
+                  const std::map<std::string, std::string> &m) {
+  auto g = getRandomGraph(20, 3, 5, 1011);
+  if (initialize) {
+    g.initialize();
+  }
+  bool caught{false};
+  try {
+    g.minSumLivenessAnnealPortfolio(nStarts, 2, 1, 10.0, m);
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error for invalid portfolio arguments");
+  }
+}
+} // namespace
+
+int main() {
+
+  assertBestOfStarts(getRandomGraph(60, 4, 15, 1011), "random");
+  assertBestOfStarts(getRecomputeGraph(getLogNSeries(30)), "recompute");
+
+  assertThrows(false, 4, {});
+  assertThrows(true, 0, {});
+  assertThrows(true, 4, {{"seed", "3"}});
+
+  return 0;
+}
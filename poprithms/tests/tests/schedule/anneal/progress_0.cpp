@@ -0,0 +1,150 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+// The progress callback and cancellation token of minSumLivenessAnneal.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+Graph getInitialized(uint64_t nOps) {
+  auto g = getRandomGraph(nOps, 4, 20, 1011);
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  return g;
+}
+
+void testProgress() {
+  auto g = getInitialized(100);
+  std::vector<AnnealProgress> progress;
+  AnnealOptions options;
+  options.progressCallback = [&progress](const AnnealProgress &p) {
+    progress.push_back(p);
+  };
+  g.minSumLivenessAnneal(options);
+
+  if (progress.empty()) {
+    throw error("Expected the progress callback to be called");
+  }
+  for (uint64_t i = 0; i < progress.size(); ++i) {
+    if (progress[i].round != i + 1) {
+      throw error("Progress rounds should be consecutive from 1");
+    }
+    if (i > 0 &&
+        progress[i].elapsedSeconds < progress[i - 1].elapsedSeconds) {
+      throw error("Progress elapsed time should not decrease");
+    }
+  }
+  if (progress.back().sumLiveness != g.getSumLiveness()) {
+    throw error("The final progress sum liveness is incorrect");
+  }
+
+  // observing progress does not change the schedule
+  auto g1 = getInitialized(100);
+  g1.minSumLivenessAnneal(AnnealOptions());
+  if (g1.getScheduleToOp() != g.getScheduleToOp()) {
+    throw error("The progress callback changed the schedule");
+  }
+}
+
+void testCancelFromCallback() {
+  auto g = getInitialized(100);
+  std::atomic<bool> cancel{false};
+  uint64_t nRounds{0};
+  AnnealOptions options;
+  options.cancel           = &cancel;
+  options.progressCallback = [&cancel, &nRounds](const AnnealProgress &p) {
+    nRounds = p.round;
+    if (p.round == 2) {
+      cancel = true;
+    }
+  };
+  g.minSumLivenessAnneal(options);
+  if (nRounds != 2) {
+    throw error("Expected annealing to stop after the cancelled round");
+  }
+  g.assertCorrectness();
+}
+
+uint64_t getNRounds(Graph g, AnnealOptions options) {
+  uint64_t nRounds{0};
+  options.progressCallback = [&nRounds](const AnnealProgress &p) {
+    nRounds = p.round;
+  };
+  g.minSumLivenessAnneal(options);
+  return nRounds;
+}
+
+// The first round waits until another thread has cancelled, so that the
+// cancellation is certain to land while annealing is in progress
+void testCancelFromThread() {
+  auto g = getInitialized(1000);
+  AnnealOptions options;
+  options.nThreads = 2;
+
+  const auto nRoundsUncancelled = getNRounds(g, options);
+  if (nRoundsUncancelled < 2) {
+    throw error("Expected more than 1 round without cancellation, "
+                "otherwise this test is not testing cancellation");
+  }
+
+  std::atomic<bool> cancel{false};
+  std::atomic<bool> started{false};
+  uint64_t nRounds{0};
+  options.cancel           = &cancel;
+  options.progressCallback = [&cancel, &started, &nRounds](
+                                 const AnnealProgress &p) {
+    nRounds = p.round;
+    started = true;
+    while (!cancel) {
+      std::this_thread::yield();
+    }
+  };
+  std::thread canceller([&cancel, &started]() {
+    while (!started) {
+      std::this_thread::yield();
+    }
+    cancel = true;
+  });
+  g.minSumLivenessAnneal(options);
+  canceller.join();
+  if (nRounds != 1) {
+    std::ostringstream oss;
+    oss << "Expected annealing to stop after the first round when "
+        << "cancelled from another thread, not after " << nRounds
+        << " of the " << nRoundsUncancelled << " rounds without "
+        << "cancellation";
+    throw error(oss.str());
+  }
+  g.assertCorrectness();
+}
+
+void testCancelBeforeStart() {
+  auto g             = getInitialized(100);
+  const auto initial = g.getScheduleToOp();
+  std::atomic<bool> cancel{true};
+  AnnealOptions options;
+  options.cancel             = &cancel;
+  options.initialTemperature = 5.0;
+  g.minSumLivenessAnneal(options);
+  if (g.getScheduleToOp() != initial) {
+    throw error("Expected no changes when cancelled before starting");
+  }
+}
+} // namespace
+
+int main() {
+  testProgress();
+  testCancelFromCallback();
+  testCancelFromThread();
+  testCancelBeforeStart();
+  return 0;
+}
@@ -0,0 +1,177 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+// Allocs in different memory resources. The liveness of the Graph is the
+// resource-weighted sum of the liveness of each resource, and the sum and
+// max liveness of each resource are available separately.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+// A copy of g, where Alloc a is in resource a % nResources
+Graph withResources(const Graph &g, ResourceClass nResources) {
+  Graph resourced;
+  for (const auto &op : g.getOps()) {
+    resourced.insertOp(g.getDebugString(op.getAddress()));
+  }
+  for (const auto &alloc : g.getAllocs()) {
+    resourced.insertAlloc(
+        alloc.getWeight(),
+        static_cast<ResourceClass>(alloc.getAddress() % nResources));
+    for (auto opAddress : alloc.getOps()) {
+      resourced.insertOpAlloc(opAddress, alloc.getAddress());
+    }
+  }
+  for (const auto &op : g.getOps()) {
+    for (auto out : op.getOuts()) {
+      resourced.insertConstraint(op.getAddress(), out);
+    }
+  }
+  return resourced;
+}
+
+// The liveness of the Graph is the weighted sum of the resource liveness
+void assertWeightedSum(const Graph &g, const std::vector<double> &weights) {
+  auto sum = AllocWeight::zero();
+  for (ResourceClass r = 0; r < g.nResourceClasses(); ++r) {
+    sum += weights[r] * g.getSumLiveness(r);
+  }
+  if (absolute(sum - g.getSumLiveness()).getL1() > 1e-6 * getL1(sum)) {
+    std::ostringstream oss;
+    oss << "Expected the sum liveness " << g.getSumLiveness()
+        << " to be the weighted sum of the resource sum liveness, " << sum;
+    throw error(oss.str());
+  }
+}
+
+void assertResourcesTracked() {
+  const auto g0 = withResources(getRandomGraph(60, 3, 10, 1011), 3);
+  if (g0.nResourceClasses() != 3) {
+    throw error("Expected 3 resource classes");
+  }
+
+  auto g = g0;
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  assertWeightedSum(g, {1.0, 1.0, 1.0});
+  g.minSumLivenessAnneal();
+  assertWeightedSum(g, {1.0, 1.0, 1.0});
+
+  // With non-negative Alloc weights, the liveness of each resource is at
+  // most the liveness of the Graph at every schedule index
+  for (ResourceClass r = 0; r < g.nResourceClasses(); ++r) {
+    if (g.getMaxLiveness() < g.getMaxLiveness(r) ||
+        !(AllocWeight::zero() < g.getMaxLiveness(r))) {
+      std::ostringstream oss;
+      oss << "Unexpected max liveness " << g.getMaxLiveness(r)
+          << " of resource " << r << ", where the max liveness of the "
+          << "Graph is " << g.getMaxLiveness();
+      throw error(oss.str());
+    }
+  }
+}
+
+// Weighting a resource more heavily lowers its liveness
+void assertWeightsSteer() {
+  const auto g0 = withResources(getRandomGraph(60, 3, 10, 1011), 2);
+
+  auto anneal = [&g0](double weight0, double weight1) {
+    auto g = g0;
+    g.setResourceWeight(0, weight0);
+    g.setResourceWeight(1, weight1);
+    g.initialize(KahnTieBreaker::RANDOM, 1011);
+    g.minSumLivenessAnneal();
+    assertWeightedSum(g, {weight0, weight1});
+    return g;
+  };
+
+  const auto favour0 = anneal(1.0, 0.01);
+  const auto favour1 = anneal(0.01, 1.0);
+  std::cout << "resource 0 favoured : " << favour0.getSumLiveness(0) << ", "
+            << favour0.getSumLiveness(1) << "\nresource 1 favoured : "
+            << favour1.getSumLiveness(0) << ", " << favour1.getSumLiveness(1)
+            << std::endl;
+  if (!(favour0.getSumLiveness(0) < favour1.getSumLiveness(0)) ||
+      !(favour1.getSumLiveness(1) < favour0.getSumLiveness(1))) {
+    throw error("Expected the heavily weighted resource to have the lower "
+                "sum liveness");
+  }
+}
+
+void assertSerialized() {
+  auto g0 = withResources(getRandomGraph(20, 3, 5, 1011), 2);
+  const auto g1 = Graph::fromSerializationString(g0.getSerializationString());
+  if (g0 != g1) {
+    throw error("Expected the resource classes to be serialized");
+  }
+
+  g0.setResourceWeight(1, 0.1);
+  if (g0 == g1) {
+    throw error("Expected Graphs with different resource weights to differ");
+  }
+  const auto g2 = Graph::fromSerializationString(g0.getSerializationString());
+  if (g0 != g2 || g2.getResourceWeight(1) != 0.1) {
+    throw error("Expected the resource weights to be serialized");
+  }
+}
+
+// The cap is on the liveness of the Graph, which is not supported with more
+// than one resource
+void assertCapThrows() {
+  const auto g0 = withResources(getRandomGraph(20, 3, 5, 1011), 2);
+  bool caught{false};
+  try {
+    auto g = g0;
+    g.setLivenessCap(1e6);
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error for a cap with 2 resource classes");
+  }
+
+  // An Alloc in a second resource, inserted after the cap is set, with
+  // Kahn's algorithm and with a schedule to warm-start from
+  auto uncapped = getRandomGraph(20, 3, 5, 1011);
+  uncapped.initialize();
+  const auto schedule = uncapped.getScheduleToOp();
+  const std::vector<std::function<void(Graph &)>> initializers{
+      [](Graph &g) { g.initialize(); },
+      [&schedule](Graph &g) { g.initialize(schedule); }};
+  for (const auto &initialize : initializers) {
+    auto g = getRandomGraph(20, 3, 5, 1011);
+    g.setLivenessCap(1e6);
+    g.insertOpAlloc(0, g.insertAlloc(1.0, 1));
+    caught = false;
+    try {
+      initialize(g);
+    } catch (const poprithms::util::error &) {
+      caught = true;
+    }
+    if (!caught) {
+      throw error("Expected initialize to throw for a cap with 2 resource "
+                  "classes");
+    }
+  }
+}
+} // namespace
+
+int main() {
+  assertResourcesTracked();
+  assertWeightsSteer();
+  assertSerialized();
+  assertCapThrows();
+  assertThrowsWhenInitialized(
+      [](Graph &g) { g.setResourceWeight(0, 2.0); },
+      "setting a resource weight after initialization");
+  return 0;
+}
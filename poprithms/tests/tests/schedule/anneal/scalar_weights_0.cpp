@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// When all Allocs have weights only in the centre lexicographic position,
+// doubles are used in place of AllocWeights in the ripple algorithm. In this
+// test we check that the schedule obtained is the same as when AllocWeights
+// are used.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertScalarMatchesVector(const Graph &g0,
+                               const std::string &description) {
+
+  auto anneal = [](Graph &g) {
+    g.initialize(KahnTieBreaker::RANDOM, 1011);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    g.minSumLivenessAnneal({{"seed", "1012"}});
+    auto t1 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+  };
+
+  // Graph with only centre weights: the scalar path is used
+  auto scalarGraph = g0;
+  auto scalarTime  = anneal(scalarGraph);
+
+  // An Alloc with a non-centre weight, used by a single Op, does not change
+  // which schedules are optimal but forces AllocWeights to be used.
+  auto vectorGraph = g0;
+  auto lexicoAlloc = vectorGraph.insertAlloc(AllocWeight(1.0, -1));
+  vectorGraph.insertOpAlloc(0, lexicoAlloc);
+  auto vectorTime = anneal(vectorGraph);
+
+  std::cout << description << " : scalar time = " << scalarTime
+            << " [s], vector time = " << vectorTime << " [s]" << std::endl;
+
+  if (scalarGraph.getScheduleToOp() != vectorGraph.getScheduleToOp()) {
+    throw error("Scalar and vector ripple algorithms give different "
+                "schedules for " +
+                description);
+  }
+
+  if (scalarGraph.getSumLiveness() + AllocWeight(1.0, -1) !=
+      vectorGraph.getSumLiveness()) {
+    throw error("Unexpected difference in sum liveness for " + description);
+  }
+}
+} // namespace
+
+int main() {
+  assertScalarMatchesVector(getRandomGraph(200, 5, 30, 1011), "random");
+  assertScalarMatchesVector(getRecomputeGraph(getSqrtSeries(100)),
+                            "recompute");
+  return 0;
+}
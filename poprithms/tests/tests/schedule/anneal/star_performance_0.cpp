@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/annealcommandlineoptions.hpp>
+#include <testutil/schedule/anneal/star_generator.hpp>
+
+// Compare the time to grow a Graph with very high fan-out with and without
+// deferred deduplication, and check that both modes result in the same
+// finalized Graph. Also time initializing it with a liveness cap, for which
+// all leaves of a centre are ready together.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+Graph timedStarGraph(uint64_t nCentres, uint64_t nLeaves, bool deferDedup) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto g     = getStarGraph(nCentres, nLeaves, 1011, deferDedup);
+  g.finalize();
+  auto stop = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = stop - start;
+  std::cout << "deferDeduplication = " << deferDedup << " : "
+            << elapsed.count() << " [s]" << std::endl;
+  return g;
+}
+
+void testDeferredDuplicates() {
+  auto g = getStarGraph(2, 10, 1012, true);
+  if (!g.isDeferringDeduplication() || g.nConstraints() != 2 * 2 * 10) {
+    throw error("Expected duplicate constraints to be stored in deferred "
+                "deduplication mode");
+  }
+
+  // all duplicates of a constraint are removed together
+  const auto leaf = g.getOp(0).getOuts()[0];
+  g.removeConstraint(0, leaf);
+  if (g.getOp(0).hasOut(leaf) || g.getOp(leaf).hasIn(0)) {
+    throw error("Expected all duplicates of a constraint to be removed");
+  }
+
+  g.finalize();
+  if (g.isDeferringDeduplication() || g.nConstraints() != 2 * 10 - 1) {
+    throw error("Expected finalize to remove duplicates and end deferred "
+                "deduplication mode");
+  }
+
+  g.initialize();
+  bool caught{false};
+  try {
+    g.deferDeduplication();
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error when deferring deduplication in an "
+                "initialized Graph");
+  }
+}
+
+// With a cap below the weight of 2 centre Allocs, the leaves of one centre
+// are all scheduled before the next centre
+void timedCappedInitialize(uint64_t nCentres, uint64_t nLeaves) {
+  const AllocWeight cap(150.0, 0);
+  auto g = getStarGraph(nCentres, nLeaves, 1011, false);
+  g.setLivenessCap(cap);
+  auto start = std::chrono::high_resolution_clock::now();
+  g.initialize();
+  auto stop = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = stop - start;
+  std::cout << "initialize with liveness cap : " << elapsed.count() << " [s]"
+            << std::endl;
+  if (cap < g.getMaxLiveness()) {
+    std::ostringstream oss;
+    oss << "Expected the liveness cap of " << cap << " to be respected, but "
+        << "the maximum liveness is " << g.getMaxLiveness();
+    throw error(oss.str());
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+
+  auto opts = AnnealCommandLineOptions().getCommandLineOptionsMap(
+      argc,
+      argv,
+      {"nCentres", "nLeaves"},
+      {"Number of Ops with high fan-out", "Number of outs of each of them"});
+  auto nCentres = static_cast<uint64_t>(std::stoi(opts.at("nCentres")));
+  auto nLeaves  = static_cast<uint64_t>(std::stoi(opts.at("nLeaves")));
+
+  auto g0 = timedStarGraph(nCentres, nLeaves, false);
+  auto g1 = timedStarGraph(nCentres, nLeaves, true);
+  if (g0 != g1 || g0.nConstraints() != nCentres * nLeaves) {
+    throw error("Expected the same Graph with and without deferred "
+                "deduplication");
+  }
+  for (const auto &op : g1.getOps()) {
+    if (!op.isSorted()) {
+      throw error("Expected all Ops to be sorted after finalize");
+    }
+  }
+
+  testDeferredDuplicates();
+  timedCappedInitialize(nCentres, nLeaves);
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/grid_generator.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// With filterSusceptible, each round only considers the Ops near the
+// changes of the previous round. Annealing must still end in a schedule
+// where no single Op can be shifted to reduce the sum liveness, which is
+// confirmed by annealing again without filterSusceptible.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertLocalMinimum(Graph g, const std::string &description) {
+
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  AnnealOptions filtered;
+  filtered.filterSusceptible = true;
+  filtered.seed              = 1012;
+  g.minSumLivenessAnneal(filtered);
+
+  int nChangesInFirstRound{-1};
+  AnnealOptions unfiltered;
+  unfiltered.filterSusceptible = false;
+  unfiltered.progressCallback  = [&nChangesInFirstRound](
+                                    const AnnealProgress &p) {
+    if (p.round == 1) {
+      nChangesInFirstRound = p.nChangesInCurrentRound;
+    }
+  };
+  g.minSumLivenessAnneal(unfiltered);
+
+  if (nChangesInFirstRound != 0) {
+    std::ostringstream oss;
+    oss << "Expected annealing with filterSusceptible to end at a local "
+        << "minimum for " << description << ", but the first round "
+        << "without filterSusceptible made " << nChangesInFirstRound
+        << " changes.";
+    throw error(oss.str());
+  }
+}
+} // namespace
+
+int main() {
+  assertLocalMinimum(getRandomGraph(300, 4, 20, 1011), "random");
+  assertLocalMinimum(getRecomputeGraph(getSqrtSeries(60)), "recompute");
+  assertLocalMinimum(getGridGraph0(8), "grid");
+  return 0;
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+#include <testutil/schedule/anneal/recompute_generator.hpp>
+
+// The temperature phase of minSumLivenessAnneal accepts liveness increasing
+// shifts, but it is followed by a T=0 phase. Check that the final schedules
+// are valid, deterministic, and not worse than the initial schedules.
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+void assertValidAndDeterministic(const Graph &g0,
+                                 const std::string &description) {
+
+  auto g = g0;
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  const auto initialLiveness = g.getSumLiveness();
+  g.minSumLivenessAnneal({{"seed", "1012"}});
+  const auto zeroTemperatureLiveness = g.getSumLiveness();
+
+  for (auto cooling : {CoolingSchedule::GEOMETRIC,
+                       CoolingSchedule::LINEAR,
+                       CoolingSchedule::ADAPTIVEREHEAT}) {
+
+    // The number of liveness increasing shifts accepted, as reported after
+    // the first round
+    uint64_t nUphillAccepted{0};
+    auto anneal = [&g0, cooling, &nUphillAccepted]() {
+      auto g1 = g0;
+      g1.initialize(KahnTieBreaker::RANDOM, 1011);
+      AnnealOptions options;
+      options.seed               = 1012;
+      options.initialTemperature = 4.0;
+      options.coolingSchedule    = cooling;
+      options.nTemperatureSteps  = 15;
+      options.coolingRate        = 0.7;
+      options.progressCallback   = [&nUphillAccepted](
+                                     const AnnealProgress &p) {
+        nUphillAccepted = p.nUphillAccepted;
+      };
+      g1.minSumLivenessAnneal(options);
+      return g1;
+    };
+
+    auto g1 = anneal();
+    if (!g1.isSchedulable()) {
+      throw error("Invalid schedule after temperature annealing");
+    }
+    if (nUphillAccepted == 0) {
+      throw error("Expected the temperature phase to accept a liveness "
+                  "increasing shift, for " +
+                  description);
+    }
+    const auto temperatureLiveness = g1.getSumLiveness();
+
+    std::cout << description << ", " << cooling
+              << " : T=0 only = " << zeroTemperatureLiveness
+              << ", with temperature = " << temperatureLiveness
+              << ", liveness increasing shifts accepted = " << nUphillAccepted
+              << std::endl;
+
+    if (initialLiveness < temperatureLiveness) {
+      throw error("Temperature annealing increased sum liveness, for " +
+                  description);
+    }
+
+    if (anneal().getScheduleToOp() != g1.getScheduleToOp()) {
+      throw error("Temperature annealing is not deterministic, for " +
+                  description);
+    }
+  }
+}
+
+// The temperature phase stops within half of the swap limit, even if that
+// is reached part way through a level
+void assertWithinSwapLimit() {
+  auto g = getRandomGraph(200, 5, 20, 1011);
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  AnnealOptions options;
+  options.initialTemperature = 1e9;
+  options.nTemperatureSteps  = 5;
+  options.swapLimitCount     = 20;
+  uint64_t nUphillAccepted{0};
+  options.progressCallback = [&nUphillAccepted](const AnnealProgress &p) {
+    nUphillAccepted = p.nUphillAccepted;
+  };
+  g.minSumLivenessAnneal(options);
+  if (nUphillAccepted == 0 ||
+      nUphillAccepted > static_cast<uint64_t>(options.swapLimitCount / 2)) {
+    throw error("Expected between 1 and half of the swap limit of liveness "
+                "increasing shifts in the temperature phase, not " +
+                std::to_string(nUphillAccepted));
+  }
+}
+} // namespace
+
+int main() {
+
+  assertValidAndDeterministic(getRandomGraph(100, 5, 20, 1011), "random");
+  assertValidAndDeterministic(getRecomputeGraph(getSqrtSeries(40)),
+                              "recompute");
+  assertWithinSwapLimit();
+
+  assertAnnealThrows({{"initialTemperature", "-1"}},
+                     "a negative initial temperature");
+  assertAnnealThrows({{"initialTemperature", "1"}, {"coolingRate", "1.5"}},
+                     "a cooling rate above 1");
+  assertAnnealThrows({{"coolingSchedule", "exponential"}},
+                     "an unknown cooling schedule");
+  assertThrowsWhenInitialized(
+      [](Graph &g) {
+        AnnealOptions options;
+        options.algo               = MinSumLivenessAlgo::SIMPLE;
+        options.initialTemperature = 1.0;
+        g.minSumLivenessAnneal(options);
+      },
+      "a temperature with the SIMPLE algorithm");
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <poprithms/schedule/anneal/error.hpp>
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+namespace {
+
+using namespace poprithms::schedule::anneal;
+
+double anneal(Graph &g) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+  g.minSumLivenessAnneal({{"seed", "1012"}});
+  auto t1 = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(t1 - t0).count();
+}
+
+void assertInvalid(const Graph &g0,
+                   const std::vector<OpAddress> &schedule,
+                   const std::string &description) {
+  auto g = g0;
+  bool caught{false};
+  try {
+    g.initialize(schedule);
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error for invalid schedule, " + description);
+  }
+}
+
+void testWarmStart() {
+
+  const auto g0 = getRandomGraph(200, 4, 30, 1011);
+  auto g        = g0;
+  g.initialize(KahnTieBreaker::RANDOM, 1011);
+  anneal(g);
+  const auto annealed = g.getScheduleToOp();
+
+  // Initializing with the annealed schedule reproduces the annealed state.
+  auto warm = g0;
+  warm.initialize(annealed);
+  warm.assertCorrectness();
+  if (warm.getScheduleToOp() != annealed ||
+      warm.getSumLiveness() != g.getSumLiveness()) {
+    throw error("Warm started Graph differs from the annealed Graph");
+  }
+
+  // Modify the Graph by adding an Op, which is inserted into the annealed
+  // schedule directly after its producer. Annealing from this schedule is
+  // faster than annealing from scratch.
+  auto modified       = g0;
+  const auto producer = annealed[annealed.size() / 2];
+  const auto extra    = modified.insertOp("extra");
+  modified.insertConstraint(producer, extra);
+  const auto extraAlloc = modified.insertAlloc(5.0);
+  modified.insertOpAlloc({producer, extra}, extraAlloc);
+
+  auto modifiedSchedule = annealed;
+  modifiedSchedule.insert(std::next(std::find(modifiedSchedule.cbegin(),
+                                              modifiedSchedule.cend(),
+                                              producer)),
+                          extra);
+
+  auto cold = modified;
+  cold.initialize(KahnTieBreaker::RANDOM, 1011);
+  const auto coldTime = anneal(cold);
+
+  auto warmModified = modified;
+  warmModified.initialize(modifiedSchedule);
+  const auto warmTime = anneal(warmModified);
+
+  std::cout << "cold start : " << coldTime << " [s], sum liveness "
+            << cold.getSumLiveness() << "\nwarm start : " << warmTime
+            << " [s], sum liveness " << warmModified.getSumLiveness()
+            << std::endl;
+
+  // Invalid schedules
+  auto tooShort = annealed;
+  tooShort.pop_back();
+  assertInvalid(g0, tooShort, "too short");
+
+  auto repeated = annealed;
+  repeated[0]   = repeated[1];
+  assertInvalid(g0, repeated, "repeated Op");
+
+  auto reversed = annealed;
+  std::reverse(reversed.begin(), reversed.end());
+  assertInvalid(g0, reversed, "constraints not satisfied");
+}
+
+void testLinks() {
+  Graph g;
+  auto a = g.insertOp("a");
+  auto b = g.insertOp("b");
+  auto c = g.insertOp("c");
+  g.insertLink(a, b);
+  assertInvalid(g, {a, c, b}, "link not satisfied");
+  g.initialize({c, a, b});
+  g.assertCorrectness();
+}
+} // namespace
+
+int main() {
+  testWarmStart();
+  testLinks();
+  return 0;
+}
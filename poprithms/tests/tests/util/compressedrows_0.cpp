@@ -0,0 +1,74 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <poprithms/util/compressedrows.hpp>
+#include <poprithms/util/error.hpp>
+
+// Compare row rotations of a CompressedRows to those of a vector of vectors.
+
+namespace {
+
+using namespace poprithms::util;
+
+void assertEqual(const CompressedRows<int> &rows,
+                 const std::vector<std::vector<int>> &expected) {
+  if (rows.nRows() != expected.size()) {
+    throw error("util", "Incorrect number of rows in CompressedRows");
+  }
+  for (uint64_t r = 0; r < rows.nRows(); ++r) {
+    const auto row = rows[r];
+    if (row.size() != expected[r].size() ||
+        !std::equal(row.cbegin(), row.cend(), expected[r].cbegin())) {
+      throw error("util", "Incorrect row in CompressedRows");
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+
+  std::mt19937 g(1011);
+  for (uint64_t n : {1, 2, 3, 7, 16}) {
+    std::vector<std::vector<int>> expected(n);
+    CompressedRows<int> rows;
+    for (auto &row : expected) {
+      row.resize(g() % 4);
+      for (auto &x : row) {
+        x = static_cast<int>(g() % 100);
+      }
+      rows.appendRow(row.cbegin(), row.cend());
+    }
+    assertEqual(rows, expected);
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+      std::vector<uint64_t> bounds{
+          g() % (n + 1), g() % (n + 1), g() % (n + 1)};
+      std::sort(bounds.begin(), bounds.end());
+      rows.rotateRows(bounds[0], bounds[1], bounds[2]);
+      std::rotate(std::next(expected.begin(), bounds[0]),
+                  std::next(expected.begin(), bounds[1]),
+                  std::next(expected.begin(), bounds[2]));
+      assertEqual(rows, expected);
+
+      // modify a row in place
+      const auto r = g() % n;
+      for (auto &x : rows.row(r)) {
+        ++x;
+      }
+      for (auto &x : expected[r]) {
+        ++x;
+      }
+      assertEqual(rows, expected);
+    }
+
+    auto copied = rows;
+    if (copied != rows) {
+      throw error("util", "Copied CompressedRows should compare equal");
+    }
+  }
+
+  return 0;
+}
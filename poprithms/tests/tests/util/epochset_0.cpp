@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <random>
+#include <set>
+#include <vector>
+
+#include <poprithms/util/epochset.hpp>
+#include <poprithms/util/error.hpp>
+
+// Compare insertions into an EpochSet, which is cleared and reused, to
+// insertions into a std::set.
+
+int main() {
+
+  using namespace poprithms::util;
+
+  std::mt19937 g(1011);
+  const uint64_t n = 40;
+  EpochSet epochSet(n);
+
+  for (int iteration = 0; iteration < 200; ++iteration) {
+    epochSet.clear();
+    if (!epochSet.empty()) {
+      throw error("util", "EpochSet not empty after clear");
+    }
+    std::set<uint64_t> expected;
+    std::vector<uint64_t> order;
+    const auto nInserts = g() % (2 * n);
+    for (uint64_t i = 0; i < nInserts; ++i) {
+      const auto id       = g() % n;
+      const bool inserted = expected.insert(id).second;
+      if (inserted) {
+        order.push_back(id);
+      }
+      if (epochSet.insert(id) != inserted) {
+        throw error("util", "EpochSet insert returned the wrong value");
+      }
+    }
+    if (epochSet.get() != order) {
+      throw error("util", "EpochSet ids not in insertion order");
+    }
+    for (uint64_t id = 0; id < n; ++id) {
+      if (epochSet.contains(id) != (expected.count(id) != 0)) {
+        throw error("util", "EpochSet contains is incorrect");
+      }
+    }
+  }
+
+  epochSet.clear();
+  epochSet.insert(5);
+  const auto copied = epochSet;
+  if (copied.get() != std::vector<uint64_t>{5} || !copied.contains(5)) {
+    throw error("util", "EpochSet copy is incorrect");
+  }
+
+  epochSet.insert(3);
+  epochSet.setUniverseSize(2 * n);
+  if (!epochSet.empty() || epochSet.universeSize() != 2 * n ||
+      epochSet.contains(3)) {
+    throw error("util", "EpochSet not empty after setUniverseSize");
+  }
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <map>
+#include <random>
+#include <vector>
+
+#include <poprithms/util/error.hpp>
+#include <poprithms/util/indexedheap.hpp>
+
+// Compare pushes, pops, removals and key updates of an IndexedHeap to those of a map
+// from id to key.
+
+int main() {
+
+  using namespace poprithms::util;
+
+  std::mt19937 g(1011);
+  const uint64_t nIds = 50;
+  IndexedHeap<int> heap(nIds);
+  std::map<uint64_t, int> expected;
+
+  for (int iteration = 0; iteration < 5000; ++iteration) {
+    const auto id  = g() % nIds;
+    const auto key = static_cast<int>(g() % 100);
+    const auto op  = g() % 4;
+
+    if (op == 0 && !heap.contains(id)) {
+      heap.push(id, key);
+      expected[id] = key;
+    } else if (op == 1 && heap.contains(id)) {
+      heap.update(id, key);
+      expected[id] = key;
+    } else if (op == 2 && !heap.empty()) {
+      const auto top = heap.top();
+      for (const auto &x : expected) {
+        if (x.second < expected.at(top)) {
+          throw error("util", "IndexedHeap top does not have the lowest key");
+        }
+      }
+      if (heap.pop() != top) {
+        throw error("util", "IndexedHeap pop did not return the top");
+      }
+      expected.erase(top);
+    } else if (op == 3 && heap.contains(id)) {
+      heap.remove(id);
+      expected.erase(id);
+    }
+
+    if (heap.size() != expected.size()) {
+      throw error("util", "Incorrect IndexedHeap size");
+    }
+    for (const auto &x : expected) {
+      if (!heap.contains(x.first) || heap.key(x.first) != x.second) {
+        throw error("util", "Incorrect IndexedHeap key");
+      }
+    }
+  }
+
+  return 0;
+}
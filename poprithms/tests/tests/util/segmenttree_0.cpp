@@ -0,0 +1,59 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <poprithms/util/error.hpp>
+#include <poprithms/util/segmenttree.hpp>
+
+// Compare range additions and range maxima of a SegmentTree to those of a
+// vector.
+
+int main() {
+
+  using namespace poprithms::util;
+
+  std::mt19937 g(1011);
+  for (uint64_t n : {1, 2, 3, 7, 16, 33}) {
+    std::vector<int> expected(n);
+    for (auto &x : expected) {
+      x = static_cast<int>(g() % 20) - 10;
+    }
+    SegmentTree<int> tree(expected);
+    if (tree.size() != n) {
+      throw error("util", "Incorrect SegmentTree size");
+    }
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+      const auto a     = g() % n;
+      const auto b     = g() % n;
+      const auto begin = std::min(a, b);
+      const auto end   = std::max(a, b) + 1;
+
+      if (iteration % 2 == 0) {
+        const auto delta = static_cast<int>(g() % 11) - 5;
+        tree.rangeAdd(begin, end, delta);
+        for (auto i = begin; i < end; ++i) {
+          expected[i] += delta;
+        }
+      }
+
+      const auto expectedMax = *std::max_element(expected.cbegin() + begin,
+                                                 expected.cbegin() + end);
+      if (tree.rangeMax(begin, end) != expectedMax) {
+        std::ostringstream oss;
+        oss << "Incorrect SegmentTree maximum in [" << begin << ", " << end
+            << "), expected " << expectedMax << " not "
+            << tree.rangeMax(begin, end) << '.';
+        throw error("util", oss.str());
+      }
+      if (tree.max() !=
+          *std::max_element(expected.cbegin(), expected.cend())) {
+        throw error("util", "Incorrect SegmentTree global maximum");
+      }
+    }
+  }
+
+  return 0;
+}
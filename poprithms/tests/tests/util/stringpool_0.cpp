@@ -0,0 +1,44 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <string>
+#include <vector>
+
+#include <poprithms/util/error.hpp>
+#include <poprithms/util/stringpool.hpp>
+
+// Each distinct string interned into a StringPool is stored once, and is
+// retrievable from its id, also from copies of the StringPool.
+
+int main() {
+
+  using namespace poprithms::util;
+
+  StringPool pool;
+  if (pool.size() != 1 || pool.intern("") != StringPool::EmptyId ||
+      !pool.get(StringPool::EmptyId).empty()) {
+    throw error("util", "Expected the empty string to have id 0");
+  }
+
+  std::vector<uint32_t> ids;
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    for (int i = 0; i < 100; ++i) {
+      const auto id = pool.intern("op" + std::to_string(i));
+      if (repeat == 0) {
+        ids.push_back(id);
+      } else if (id != ids[static_cast<uint64_t>(i)]) {
+        throw error("util", "Expected the same id for the same string");
+      }
+    }
+  }
+  if (pool.size() != 101) {
+    throw error("util", "Expected each distinct string to be stored once");
+  }
+
+  const auto copied = pool;
+  for (uint64_t i = 0; i < 100; ++i) {
+    if (copied.get(ids[i]) != "op" + std::to_string(i)) {
+      throw error("util", "Incorrect string in copied StringPool");
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,30 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef TESTUTIL_SCHEDULE_ANNEAL_ASSERTTHROWS_HPP
+#define TESTUTIL_SCHEDULE_ANNEAL_ASSERTTHROWS_HPP
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include <poprithms/schedule/anneal/graph.hpp>
+
+namespace poprithms {
+namespace schedule {
+namespace anneal {
+
+// Throw an error unless f throws a poprithms::util::error, when called with
+// a small random Graph which is initialized. expected describes the error
+// which f should throw, and is in the message of the error thrown if it
+// does not throw one.
+void assertThrowsWhenInitialized(const std::function<void(Graph &)> &f,
+                                 const std::string &expected);
+
+// As above, where f is minSumLivenessAnneal with the options m
+void assertAnnealThrows(const std::map<std::string, std::string> &m,
+                        const std::string &expected);
+
+} // namespace anneal
+} // namespace schedule
+} // namespace poprithms
+
+#endif
@@ -0,0 +1,31 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef TESTUTIL_SCHEDULE_ANNEAL_STAR_HPP
+#define TESTUTIL_SCHEDULE_ANNEAL_STAR_HPP
+
+#include <poprithms/schedule/anneal/graph.hpp>
+
+namespace poprithms {
+namespace schedule {
+namespace anneal {
+
+//        centre 0     centre 1   ...
+//       /  |  |  \   /  |  |  \
+//      x   x  x   x x   x  x   x  (the nLeaves leaf Ops of each centre)
+//
+// A Graph with very high fan-out, resembling weight update Ops with many
+// consumers. Each centre has an Alloc which is live for all of its leaves,
+// and each leaf has a small Alloc of its own. As in Graphs grown by
+// frameworks, the constraints from each centre are inserted in a random
+// order, and each is inserted twice. If deferDeduplication is true, the
+// Graph is grown in deferred deduplication mode.
+
+Graph getStarGraph(uint64_t nCentres,
+                   uint64_t nLeaves,
+                   uint32_t seed,
+                   bool deferDeduplication);
+
+} // namespace anneal
+} // namespace schedule
+} // namespace poprithms
+
+#endif
@@ -13,7 +13,18 @@ AnnealCommandLineOptions::getAlgoCommandLineOptions() const {
                                     "pHigherFallRate",
                                     "pClimb",
                                     "logging",
-                                    "filterSusceptible"};
+                                    "filterSusceptible",
+                                    "nThreads",
+                                    "initialTemperature",
+                                    "coolingSchedule",
+                                    "nTemperatureSteps",
+                                    "coolingRate",
+                                    "objective",
+                                    "maxWeight",
+                                    "nTabuIterations",
+                                    "tabuTenure",
+                                    "targetGapPercent",
+                                    "windowSize"};
   return x;
 }
 
@@ -0,0 +1,33 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <poprithms/schedule/anneal/error.hpp>
+#include <testutil/schedule/anneal/assertthrows.hpp>
+#include <testutil/schedule/anneal/randomgraph.hpp>
+
+namespace poprithms {
+namespace schedule {
+namespace anneal {
+
+void assertThrowsWhenInitialized(const std::function<void(Graph &)> &f,
+                                 const std::string &expected) {
+  auto g = getRandomGraph(20, 3, 5, 1011);
+  g.initialize();
+  bool caught{false};
+  try {
+    f(g);
+  } catch (const poprithms::util::error &) {
+    caught = true;
+  }
+  if (!caught) {
+    throw error("Expected an error for " + expected);
+  }
+}
+
+void assertAnnealThrows(const std::map<std::string, std::string> &m,
+                        const std::string &expected) {
+  assertThrowsWhenInitialized([&m](Graph &g) { g.minSumLivenessAnneal(m); },
+                              expected);
+}
+
+} // namespace anneal
+} // namespace schedule
+} // namespace poprithms
@@ -27,17 +27,17 @@ Graph getBifurcatingGraph0(uint64_t D) {
     auto mm  = oa.alloc;
     auto mm0 = g.insertAlloc(1);
     auto op0 =
-        g.insertOp({op}, {mm0, mm}, g.getOp(op).getDebugString() + "0");
+        g.insertOp({op}, {mm0, mm}, g.getDebugString(op) + "0");
     auto mm1 = g.insertAlloc(1);
     auto op1 =
-        g.insertOp({op}, {mm1, mm}, g.getOp(op).getDebugString() + "1");
+        g.insertOp({op}, {mm1, mm}, g.getDebugString(op) + "1");
     return std::array<OpAlloc, 2>{OpAlloc{op0, mm0}, OpAlloc{op1, mm1}};
   };
 
   auto getBwdTie = [&g](std::array<OpAlloc, 2> oas) {
     auto oa0  = std::get<0>(oas);
     auto oa1  = std::get<1>(oas);
-    auto dbs0 = g.getOp(oa0.op).getDebugString();
+    auto dbs0 = g.getDebugString(oa0.op);
     auto dbs  = "y" + dbs0.substr(1, dbs0.size() - 2);
     auto mm   = g.insertAlloc(1);
     auto op   = g.insertOp({oa0.op, oa1.op}, {oa0.alloc, oa1.alloc, mm}, dbs);
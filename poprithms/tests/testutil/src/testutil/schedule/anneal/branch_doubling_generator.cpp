@@ -64,7 +64,7 @@ namespace {
 std::vector<int> getBranchLengths(const Graph &g) {
   std::vector<int> lengths;
   for (const auto &op : g.getOps()) {
-    auto dbs = op.getDebugString();
+    auto dbs = g.getDebugString(op.getAddress());
     if (dbs.find("Op") != std::string::npos) {
       auto a0 = std::find(dbs.begin(), dbs.end(), '_');
       auto a1 = std::find(std::next(a0), dbs.end(), '_');
@@ -119,7 +119,7 @@ void assertGlobalMinimumBranchDoubling(const Graph &g,
 
   auto livenessString = g.getLivenessString();
   for (auto i = 0; i < g.nOps(); ++i) {
-    auto dbs = g.getOp(g.scheduleToOp(i)).getDebugString();
+    auto dbs = g.getDebugString(g.scheduleToOp(i));
     if (dbs != expected[i]) {
       throw error("Unexpected");
     }
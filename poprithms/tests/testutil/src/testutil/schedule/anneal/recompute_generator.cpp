@@ -172,7 +172,7 @@ void assertGlobalMinimumRecomputeGraph0(const Graph &g) {
   std::vector<int> recomps;
   recomps.reserve(schedule.size());
   for (auto x : schedule) {
-    auto p = split(g.getOp(x).getDebugString());
+    auto p = split(g.getDebugString(x));
     layers.push_back(p.first);
     recomps.push_back(p.second);
   }
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <poprithms/schedule/anneal/graph.hpp>
+#include <testutil/schedule/anneal/star_generator.hpp>
+
+namespace poprithms {
+namespace schedule {
+namespace anneal {
+
+Graph getStarGraph(uint64_t nCentres,
+                   uint64_t nLeaves,
+                   uint32_t seed,
+                   bool deferDeduplication) {
+
+  Graph graph;
+  if (deferDeduplication) {
+    graph.deferDeduplication();
+  }
+  graph.reserve(nCentres * (nLeaves + 1), nCentres * (nLeaves + 1));
+
+  std::mt19937 g(seed);
+  for (uint64_t c = 0; c < nCentres; ++c) {
+    const auto centreAlloc = graph.insertAlloc(100.0);
+    const auto centre      = graph.insertOp("centre" + std::to_string(c));
+    graph.insertOpAlloc(centre, centreAlloc);
+
+    std::vector<OpAddress> leaves;
+    leaves.reserve(nLeaves);
+    for (uint64_t l = 0; l < nLeaves; ++l) {
+      leaves.push_back(graph.insertOp("leaf" + std::to_string(c) + "_" +
+                                      std::to_string(l)));
+      graph.insertOpAlloc(leaves.back(), centreAlloc);
+      graph.insertOpAlloc(leaves.back(), graph.insertAlloc(1.0));
+    }
+
+    std::shuffle(leaves.begin(), leaves.end(), g);
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      for (auto leaf : leaves) {
+        graph.insertConstraint(centre, leaf);
+      }
+    }
+  }
+
+  return graph;
+}
+
+} // namespace anneal
+} // namespace schedule
+} // namespace poprithms